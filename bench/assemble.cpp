@@ -0,0 +1,150 @@
+//-----------------------------------------------------------------------------
+// Benchmark for SEdgeList::AssemblePolygon: the time to chain shuffled soups
+// of edges, with random directions, into closed contours, against the linear
+// search for the next edge that it used before.
+//-----------------------------------------------------------------------------
+#include <chrono>
+#include <random>
+#include "solvespace.h"
+
+using namespace SolveSpace;
+
+static double Now(void) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The linear search is quadratic in the number of edges, so only run it
+// while it's still quick.
+static const int MAX_LINEAR = 50000;
+
+static bool LinearAssembleContour(SEdgeList *el, Vector first, Vector last,
+                                  SContour *dest)
+{
+    int i;
+
+    dest->AddPoint(first);
+    dest->AddPoint(last);
+
+    do {
+        for(i = 0; i < el->l.n; i++) {
+            SEdge *se = &(el->l.elem[i]);
+            if(se->tag) continue;
+
+            if(se->a.Equals(last)) {
+                dest->AddPoint(se->b);
+                last = se->b;
+                se->tag = 1;
+                break;
+            }
+            if(se->b.Equals(last)) {
+                dest->AddPoint(se->a);
+                last = se->a;
+                se->tag = 1;
+                break;
+            }
+        }
+        if(i >= el->l.n) return false;
+    } while(!last.Equals(first));
+
+    return true;
+}
+
+static bool LinearAssemblePolygon(SEdgeList *el, SPolygon *dest) {
+    bool allClosed = true;
+    for(;;) {
+        int i;
+        for(i = 0; i < el->l.n; i++) {
+            if(!el->l.elem[i].tag) break;
+        }
+        if(i >= el->l.n) return allClosed;
+
+        SEdge *se = &(el->l.elem[i]);
+        se->tag = 1;
+        dest->AddEmptyContour();
+        if(!LinearAssembleContour(el, se->a, se->b,
+                                  &(dest->l.elem[dest->l.n-1])))
+        {
+            allClosed = false;
+        }
+    }
+}
+
+// A soup of n edges: either many small closed polygons scattered around,
+// like the outlines of text or of a perforated panel, or one big circle.
+static void MakeSoup(SEdgeList *el, int n, bool oneLoop, std::mt19937 *rng) {
+    std::uniform_real_distribution<double> pos(-1000, 1000);
+    std::vector<SEdge> edges;
+    int sides = oneLoop ? n : 6;
+    for(int k = 0; k < n / sides; k++) {
+        Vector c = oneLoop ? Vector::From(0, 0, 0) :
+                             Vector::From(pos(*rng), pos(*rng), 0);
+        double r = oneLoop ? 500 : 0.5;
+        for(int i = 0; i < sides; i++) {
+            double a0 = 2*PI*i/sides, a1 = 2*PI*(i + 1)/sides;
+            SEdge se = {};
+            se.a = c.Plus(Vector::From(r*cos(a0), r*sin(a0), 0));
+            se.b = c.Plus(Vector::From(r*cos(a1), r*sin(a1), 0));
+            if((*rng)() & 1) std::swap(se.a, se.b);
+            edges.push_back(se);
+        }
+    }
+    std::shuffle(edges.begin(), edges.end(), *rng);
+    for(SEdge &se : edges) el->l.Add(&se);
+}
+
+static bool SamePolygon(SPolygon *a, SPolygon *b) {
+    if(a->l.n != b->l.n) return false;
+    for(int i = 0; i < a->l.n; i++) {
+        SContour *sca = &(a->l.elem[i]), *scb = &(b->l.elem[i]);
+        if(sca->l.n != scb->l.n) return false;
+        for(int j = 0; j < sca->l.n; j++) {
+            if(!sca->l.elem[j].p.EqualsExactly(scb->l.elem[j].p)) return false;
+        }
+    }
+    return true;
+}
+
+static void Run(int n, bool oneLoop, std::mt19937 *rng) {
+    SEdgeList el = {};
+    MakeSoup(&el, n, oneLoop, rng);
+
+    SPolygon sp = {};
+    double t0 = Now();
+    bool closed = el.AssemblePolygon(&sp, NULL);
+    double tHash = Now() - t0;
+    if(!closed) oops();
+
+    double tLinear = -1;
+    if(n <= MAX_LINEAR) {
+        el.l.ClearTags();
+        SPolygon spl = {};
+        t0 = Now();
+        closed = LinearAssemblePolygon(&el, &spl);
+        tLinear = Now() - t0;
+        if(!closed || !SamePolygon(&sp, &spl)) oops();
+        spl.Clear();
+    }
+
+    if(tLinear >= 0) {
+        printf("%8d %8d %9.2f %9.2f\n", n, sp.l.n, tHash*1e3, tLinear*1e3);
+    } else {
+        printf("%8d %8d %9.2f %9s\n", n, sp.l.n, tHash*1e3, "-");
+    }
+    sp.Clear();
+    el.Clear();
+}
+
+int main(int argc, char **argv) {
+    InitHeaps();
+
+    std::mt19937 rng(1);
+    printf("times in ms, to assemble n edges into contours\n");
+    printf("%8s %8s %9s %9s\n", "n", "contours", "hashed", "linear");
+    for(bool oneLoop : { false, true }) {
+        for(int n : { 1200, 12000, 48000, 600000 }) {
+            Run(n, oneLoop, &rng);
+        }
+    }
+    return 0;
+}
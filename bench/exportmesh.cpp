@@ -0,0 +1,162 @@
+//-----------------------------------------------------------------------------
+// Benchmark for MeshFileWriter: the time to write a big mesh as binary STL
+// and as Wavefront OBJ, against the unbuffered writers, with a stdio call for
+// each float or line, that were the only way to export before.
+//-----------------------------------------------------------------------------
+#include <chrono>
+#include "solvespace.h"
+
+using namespace SolveSpace;
+
+static double Now(void) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// A copy of SolveSpaceUI::ExportMeshAsStlTo and ExportMeshAsObjTo.
+static void OldStlTo(FILE *f, SMesh *sm, double s) {
+    char str[80] = {};
+    strcpy(str, "STL exported mesh");
+    fwrite(str, 1, 80, f);
+
+    uint32_t n = sm->l.n;
+    fwrite(&n, 4, 1, f);
+
+    int i;
+    for(i = 0; i < sm->l.n; i++) {
+        STriangle *tr = &(sm->l.elem[i]);
+        Vector n = tr->Normal().WithMagnitude(1);
+        float w;
+        w = (float)n.x;           fwrite(&w, 4, 1, f);
+        w = (float)n.y;           fwrite(&w, 4, 1, f);
+        w = (float)n.z;           fwrite(&w, 4, 1, f);
+        w = (float)((tr->a.x)/s); fwrite(&w, 4, 1, f);
+        w = (float)((tr->a.y)/s); fwrite(&w, 4, 1, f);
+        w = (float)((tr->a.z)/s); fwrite(&w, 4, 1, f);
+        w = (float)((tr->b.x)/s); fwrite(&w, 4, 1, f);
+        w = (float)((tr->b.y)/s); fwrite(&w, 4, 1, f);
+        w = (float)((tr->b.z)/s); fwrite(&w, 4, 1, f);
+        w = (float)((tr->c.x)/s); fwrite(&w, 4, 1, f);
+        w = (float)((tr->c.y)/s); fwrite(&w, 4, 1, f);
+        w = (float)((tr->c.z)/s); fwrite(&w, 4, 1, f);
+        fputc(0, f);
+        fputc(0, f);
+    }
+}
+
+static void OldObjTo(FILE *f, SMesh *sm, double s) {
+    SPointList spl = {};
+    STriangle *tr;
+    for(tr = sm->l.First(); tr; tr = sm->l.NextAfter(tr)) {
+        spl.IncrementTagFor(tr->a);
+        spl.IncrementTagFor(tr->b);
+        spl.IncrementTagFor(tr->c);
+    }
+
+    SPoint *sp;
+    for(sp = spl.l.First(); sp; sp = spl.l.NextAfter(sp)) {
+        fprintf(f, "v %.10f %.10f %.10f\r\n",
+                        sp->p.x / s,
+                        sp->p.y / s,
+                        sp->p.z / s);
+    }
+
+    for(tr = sm->l.First(); tr; tr = sm->l.NextAfter(tr)) {
+        fprintf(f, "f %d %d %d\r\n",
+                        spl.IndexForPoint(tr->a) + 1,
+                        spl.IndexForPoint(tr->b) + 1,
+                        spl.IndexForPoint(tr->c) + 1);
+    }
+
+    spl.Clear();
+}
+
+// A sphere of radius 50 mm, as an n by 2n grid in latitude and longitude,
+// two triangles per cell.
+static void MakeSphere(SMesh *sm, int n) {
+    auto at = [&](int i, int j) {
+        double th = PI*i/n, ph = PI*j/n;
+        return Vector::From(50*sin(th)*cos(ph), 50*sin(th)*sin(ph),
+                            50*cos(th));
+    };
+    STriMeta meta = {};
+    for(int i = 0; i < n; i++) {
+        for(int j = 0; j < 2*n; j++) {
+            Vector a = at(i, j),     b = at(i + 1, j),
+                   c = at(i + 1, j + 1), d = at(i, j + 1);
+            STriangle abc = STriangle::From(meta, a, b, c),
+                      acd = STriangle::From(meta, a, c, d);
+            if(i != n - 1) sm->l.Add(&abc);
+            if(i != 0)     sm->l.Add(&acd);
+        }
+    }
+}
+
+// Read back everything that was written to a temporary file.
+static std::string Contents(FILE *f) {
+    std::string s;
+    fflush(f);
+    s.resize(ftell(f));
+    rewind(f);
+    if(!s.empty() && fread(&s[0], 1, s.size(), f) != s.size()) oops();
+    return s;
+}
+
+typedef void WriteFn(FILE *f, SMesh *sm, double s);
+
+static double Time(WriteFn *fn, SMesh *sm, std::string *out) {
+    FILE *f = tmpfile();
+    if(!f) oops();
+    double t0 = Now();
+    fn(f, sm, 1.0);
+    fflush(f);
+    double t = Now() - t0;
+    *out = Contents(f);
+    fclose(f);
+    return t;
+}
+
+static void NewStlTo(FILE *f, SMesh *sm, double s) {
+    MeshFileWriter mfw = {};
+    mfw.f = f;
+    mfw.scale = s;
+    mfw.WriteStl(sm);
+}
+
+static void NewObjTo(FILE *f, SMesh *sm, double s) {
+    MeshFileWriter mfw = {};
+    mfw.f = f;
+    mfw.scale = s;
+    mfw.WriteObj(sm);
+}
+
+static void Run(const char *what, SMesh *sm, WriteFn *oldFn, WriteFn *newFn) {
+    std::string oldOut, newOut;
+    double tOld = Time(oldFn, sm, &oldOut);
+    double tNew = Time(newFn, sm, &newOut);
+    // On a little-endian machine the two should be the same to the byte.
+    if(oldOut != newOut) oops();
+
+    double mb = newOut.size()/1e6;
+    double mtri = sm->l.n/1e6;
+    printf("%-4s %8d %7.1f %8.2f %8.2f %7.1f %7.1f %6.2f %6.2f\n",
+        what, sm->l.n, mb, tOld*1e3, tNew*1e3, mb/tOld, mb/tNew,
+        mtri/tOld, mtri/tNew);
+}
+
+int main(int argc, char **argv) {
+    InitHeaps();
+
+    printf("times in ms, and rates in MB/s and in millions of triangles/s, "
+           "to write a mesh of n triangles\n");
+    printf("%-4s %8s %7s %8s %8s %7s %7s %6s %6s\n",
+        "", "n", "MB", "old", "new", "MB/s", "MB/s", "Mtri/s", "Mtri/s");
+    for(int n : { 64, 128, 256, 512 }) {
+        SMesh sm = {};
+        MakeSphere(&sm, n);
+        Run("stl", &sm, OldStlTo, NewStlTo);
+        Run("obj", &sm, OldObjTo, NewObjTo);
+        sm.l.Clear();
+    }
+    return 0;
+}
@@ -0,0 +1,123 @@
+//-----------------------------------------------------------------------------
+// Benchmark for IdList: the time to add items with increasing ids (as when
+// the sketch is regenerated) and in a random order, and to look them all up
+// by id through the hash index, against the binary search that the list
+// used before.
+//-----------------------------------------------------------------------------
+#include <chrono>
+#include <random>
+#include "solvespace.h"
+
+using namespace SolveSpace;
+
+static double Now(void) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Adding in a random order moves half the list each time, so only do that
+// while it's still quick.
+static const int MAX_SHUFFLED = 20000;
+
+static Param *BinarySearch(ParamList *l, hParam h) {
+    int first = 0, last = l->n - 1;
+    while(first <= last) {
+        int mid = (first + last)/2;
+        uint32_t v = l->elem[mid].h.v;
+        if(v > h.v) {
+            last = mid - 1;
+        } else if(v < h.v) {
+            first = mid + 1;
+        } else {
+            return &(l->elem[mid]);
+        }
+    }
+    return NULL;
+}
+
+static void Run(int n, std::mt19937 *rng) {
+    // Ids with gaps in them, like the ones that entities generate.
+    std::vector<uint32_t> ids(n);
+    for(int i = 0; i < n; i++) {
+        ids[i] = (uint32_t)((i / 5) << 8) + (uint32_t)(i % 5) + 1;
+    }
+    std::vector<uint32_t> shuffled = ids;
+    std::shuffle(shuffled.begin(), shuffled.end(), *rng);
+
+    ParamList l = {};
+    double t0 = Now();
+    for(int i = 0; i < n; i++) {
+        Param p = {};
+        p.h.v = ids[i];
+        p.val = i;
+        l.Add(&p);
+    }
+    double tAdd = Now() - t0;
+
+    double tShuffled = -1;
+    if(n <= MAX_SHUFFLED) {
+        ParamList ls = {};
+        t0 = Now();
+        for(int i = 0; i < n; i++) {
+            Param p = {};
+            p.h.v = shuffled[i];
+            ls.Add(&p);
+        }
+        tShuffled = Now() - t0;
+        for(int i = 0; i < n; i++) {
+            if(ls.elem[i].h.v != ids[i]) oops();
+            if(ls.FindById(ls.elem[i].h) != &(ls.elem[i])) oops();
+        }
+        ls.Clear();
+    }
+
+    double sum = 0;
+    t0 = Now();
+    for(int i = 0; i < n; i++) {
+        hParam h = { shuffled[i] };
+        sum += l.FindById(h)->val;
+    }
+    double tFind = Now() - t0;
+
+    double sumBs = 0;
+    t0 = Now();
+    for(int i = 0; i < n; i++) {
+        hParam h = { shuffled[i] };
+        sumBs += BinarySearch(&l, h)->val;
+    }
+    double tBs = Now() - t0;
+    if(sum != sumBs) oops();
+
+    // and some that aren't there
+    t0 = Now();
+    for(int i = 0; i < n; i++) {
+        hParam h = { shuffled[i] + 0x80 };
+        if(l.FindByIdNoOops(h)) oops();
+    }
+    double tMiss = Now() - t0;
+
+    if(tShuffled >= 0) {
+        printf("%8d %9.2f %9.2f %9.2f %9.2f %9.2f\n", n, tAdd*1e3,
+            tShuffled*1e3, tFind*1e3, tBs*1e3, tMiss*1e3);
+    } else {
+        printf("%8d %9.2f %9s %9.2f %9.2f %9.2f\n", n, tAdd*1e3,
+            "-", tFind*1e3, tBs*1e3, tMiss*1e3);
+    }
+    l.Clear();
+}
+
+int main(int argc, char **argv) {
+    InitHeaps();
+
+    std::mt19937 rng(1);
+    printf("times in ms, to add or look up all n\n");
+    printf("%8s %9s %9s %9s %9s %9s\n", "n", "add", "shuffled",
+        "find", "bsearch", "missing");
+    for(int n : { 10000, 20000, 100000, 1000000 }) {
+        Run(n, &rng);
+    }
+    printf("the list is kept sorted, so adding out of order costs O(n) per "
+           "item; and once the list is\nmuch bigger than the cache, a lookup "
+           "is bound by cache misses either way\n");
+    return 0;
+}
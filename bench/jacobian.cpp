@@ -0,0 +1,341 @@
+//-----------------------------------------------------------------------------
+// Benchmark for the Jacobian evaluation in the solver: for each type of
+// constraint, write many copies of its equations, and then compare the time
+// to build and evaluate the Jacobian from symbolic partial derivatives
+// against reverse-mode differentiation on the expression tape.
+//-----------------------------------------------------------------------------
+#include <chrono>
+#include "solvespace.h"
+
+using namespace SolveSpace;
+
+static const int COPIES = 100;
+static const int EVALS  = 100;
+
+static uint32_t NextParam  = 1;
+static uint32_t NextEntity = 1;
+
+static double Now(void) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static hParam AddParam(double v) {
+    Param p = {};
+    p.h.v = NextParam++;
+    p.val = v;
+    SK.param.Add(&p);
+    return p.h;
+}
+
+static hEntity AddEntity(EntityBase *e) {
+    e->h.v = NextEntity++;
+    SK.entity.Add(e);
+    return e->h;
+}
+
+static hEntity Workplane;
+
+static hEntity AddPoint2d(double u, double v) {
+    EntityBase e = {};
+    e.type = EntityBase::POINT_IN_2D;
+    e.workplane = Workplane;
+    e.param[0] = AddParam(u);
+    e.param[1] = AddParam(v);
+    return AddEntity(&e);
+}
+
+static hEntity AddPoint3d(double x, double y, double z) {
+    EntityBase e = {};
+    e.type = EntityBase::POINT_IN_3D;
+    e.workplane = EntityBase::FREE_IN_3D;
+    e.param[0] = AddParam(x);
+    e.param[1] = AddParam(y);
+    e.param[2] = AddParam(z);
+    return AddEntity(&e);
+}
+
+static hEntity AddNormal3d(Quaternion q) {
+    EntityBase e = {};
+    e.type = EntityBase::NORMAL_IN_3D;
+    e.workplane = EntityBase::FREE_IN_3D;
+    e.param[0] = AddParam(q.w);
+    e.param[1] = AddParam(q.vx);
+    e.param[2] = AddParam(q.vy);
+    e.param[3] = AddParam(q.vz);
+    return AddEntity(&e);
+}
+
+static hEntity AddLine(hEntity a, hEntity b) {
+    EntityBase e = {};
+    e.type = EntityBase::LINE_SEGMENT;
+    e.workplane = Workplane;
+    e.point[0] = a;
+    e.point[1] = b;
+    return AddEntity(&e);
+}
+
+static hEntity Normal2d;
+
+static hEntity AddCircle(double u, double v, double r) {
+    EntityBase d = {};
+    d.type = EntityBase::DISTANCE;
+    d.workplane = Workplane;
+    d.param[0] = AddParam(r);
+
+    EntityBase e = {};
+    e.type = EntityBase::CIRCLE;
+    e.workplane = Workplane;
+    e.point[0] = AddPoint2d(u, v);
+    e.normal = Normal2d;
+    e.distance = AddEntity(&d);
+    return AddEntity(&e);
+}
+
+static hEntity AddArc(double u, double v, double r) {
+    EntityBase e = {};
+    e.type = EntityBase::ARC_OF_CIRCLE;
+    e.workplane = Workplane;
+    e.point[0] = AddPoint2d(u, v);
+    e.point[1] = AddPoint2d(u + r, v);
+    e.point[2] = AddPoint2d(u, v + r);
+    e.normal = Normal2d;
+    return AddEntity(&e);
+}
+
+static hEntity AddCubic(double u, double v) {
+    EntityBase e = {};
+    e.type = EntityBase::CUBIC;
+    e.workplane = Workplane;
+    e.point[0] = AddPoint2d(u,      v);
+    e.point[1] = AddPoint2d(u + 3,  v + 5);
+    e.point[2] = AddPoint2d(u + 8,  v + 4);
+    e.point[3] = AddPoint2d(u + 11, v);
+    return AddEntity(&e);
+}
+
+// The entities that one copy of a constraint may refer to.
+struct Kit {
+    hEntity pt[4], line[4], circle[2], arc[2], cubic, pt3d[2], normal3d[2];
+};
+
+static Kit MakeKit(int i) {
+    double u = 50*(i % 40) + 0.3*(i % 7), v = 50*(i / 40) + 0.2*(i % 5);
+    Kit k;
+    for(int j = 0; j < 4; j++) {
+        k.pt[j] = AddPoint2d(u + 7*j + 1, v + 3*j*j);
+    }
+    for(int j = 0; j < 4; j++) {
+        k.line[j] = AddLine(AddPoint2d(u + 2*j, v + j), AddPoint2d(u + 10 - j, v + 4*j + 3));
+    }
+    k.circle[0] = AddCircle(u + 5, v + 5, 3);
+    k.circle[1] = AddCircle(u + 15, v + 5, 4);
+    k.arc[0] = AddArc(u + 20, v + 3, 5);
+    k.arc[1] = AddArc(u + 30, v + 8, 2);
+    k.cubic = AddCubic(u + 3, v + 20);
+    k.pt3d[0] = AddPoint3d(u, v, 3);
+    k.pt3d[1] = AddPoint3d(u + 5, v - 1, 7);
+    k.normal3d[0] = AddNormal3d(Quaternion::From(0.9, 0.1, 0.3, 0.2).WithMagnitude(1));
+    k.normal3d[1] = AddNormal3d(Quaternion::From(0.7, 0.4, 0.1, 0.5).WithMagnitude(1));
+    return k;
+}
+
+struct Case {
+    const char *name;
+    int         type;
+    bool        in3d;
+    void      (*fill)(ConstraintBase *c, const Kit &k);
+};
+
+static const Case Cases[] = {
+    { "points-coincident",  ConstraintBase::POINTS_COINCIDENT, false,
+        [](ConstraintBase *c, const Kit &k) { c->ptA = k.pt[0]; c->ptB = k.pt[1]; } },
+    { "pt-pt-distance",     ConstraintBase::PT_PT_DISTANCE, false,
+        [](ConstraintBase *c, const Kit &k) { c->ptA = k.pt[0]; c->ptB = k.pt[1]; } },
+    { "proj-pt-distance",   ConstraintBase::PROJ_PT_DISTANCE, false,
+        [](ConstraintBase *c, const Kit &k) {
+            c->ptA = k.pt[0]; c->ptB = k.pt[1]; c->entityA = k.line[0]; } },
+    { "pt-plane-distance",  ConstraintBase::PT_PLANE_DISTANCE, true,
+        [](ConstraintBase *c, const Kit &k) { c->ptA = k.pt3d[0]; c->entityA = Workplane; } },
+    { "pt-line-distance",   ConstraintBase::PT_LINE_DISTANCE, false,
+        [](ConstraintBase *c, const Kit &k) { c->ptA = k.pt[0]; c->entityA = k.line[0]; } },
+    { "pt-in-plane",        ConstraintBase::PT_IN_PLANE, true,
+        [](ConstraintBase *c, const Kit &k) { c->ptA = k.pt3d[0]; c->entityA = Workplane; } },
+    { "pt-on-line",         ConstraintBase::PT_ON_LINE, false,
+        [](ConstraintBase *c, const Kit &k) { c->ptA = k.pt[0]; c->entityA = k.line[0]; } },
+    { "pt-on-circle",       ConstraintBase::PT_ON_CIRCLE, false,
+        [](ConstraintBase *c, const Kit &k) { c->ptA = k.pt[0]; c->entityA = k.circle[0]; } },
+    { "equal-length-lines", ConstraintBase::EQUAL_LENGTH_LINES, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.line[0]; c->entityB = k.line[1]; } },
+    { "length-ratio",       ConstraintBase::LENGTH_RATIO, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.line[0]; c->entityB = k.line[1]; } },
+    { "length-difference",  ConstraintBase::LENGTH_DIFFERENCE, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.line[0]; c->entityB = k.line[1]; } },
+    { "eq-len-pt-line-d",   ConstraintBase::EQ_LEN_PT_LINE_D, false,
+        [](ConstraintBase *c, const Kit &k) {
+            c->entityA = k.line[0]; c->ptA = k.pt[0]; c->entityB = k.line[1]; } },
+    { "eq-pt-ln-distances", ConstraintBase::EQ_PT_LN_DISTANCES, false,
+        [](ConstraintBase *c, const Kit &k) {
+            c->entityA = k.line[0]; c->ptA = k.pt[0];
+            c->entityB = k.line[1]; c->ptB = k.pt[1]; } },
+    { "equal-angle",        ConstraintBase::EQUAL_ANGLE, false,
+        [](ConstraintBase *c, const Kit &k) {
+            c->entityA = k.line[0]; c->entityB = k.line[1];
+            c->entityC = k.line[2]; c->entityD = k.line[3]; } },
+    { "equal-line-arc-len", ConstraintBase::EQUAL_LINE_ARC_LEN, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.line[0]; c->entityB = k.arc[0]; } },
+    { "symmetric",          ConstraintBase::SYMMETRIC, true,
+        [](ConstraintBase *c, const Kit &k) {
+            c->ptA = k.pt3d[0]; c->ptB = k.pt3d[1]; c->entityA = Workplane; } },
+    { "symmetric-horiz",    ConstraintBase::SYMMETRIC_HORIZ, false,
+        [](ConstraintBase *c, const Kit &k) { c->ptA = k.pt[0]; c->ptB = k.pt[1]; } },
+    { "symmetric-vert",     ConstraintBase::SYMMETRIC_VERT, false,
+        [](ConstraintBase *c, const Kit &k) { c->ptA = k.pt[0]; c->ptB = k.pt[1]; } },
+    { "symmetric-line",     ConstraintBase::SYMMETRIC_LINE, false,
+        [](ConstraintBase *c, const Kit &k) {
+            c->ptA = k.pt[0]; c->ptB = k.pt[1]; c->entityA = k.line[0]; } },
+    { "at-midpoint",        ConstraintBase::AT_MIDPOINT, false,
+        [](ConstraintBase *c, const Kit &k) { c->ptA = k.pt[0]; c->entityA = k.line[0]; } },
+    { "horizontal",         ConstraintBase::HORIZONTAL, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.line[0]; } },
+    { "vertical",           ConstraintBase::VERTICAL, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.line[0]; } },
+    { "diameter",           ConstraintBase::DIAMETER, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.circle[0]; } },
+    { "equal-radius",       ConstraintBase::EQUAL_RADIUS, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.circle[0]; c->entityB = k.circle[1]; } },
+    { "same-orientation",   ConstraintBase::SAME_ORIENTATION, true,
+        [](ConstraintBase *c, const Kit &k) {
+            c->entityA = k.normal3d[0]; c->entityB = k.normal3d[1]; } },
+    { "angle",              ConstraintBase::ANGLE, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.line[0]; c->entityB = k.line[1]; } },
+    { "parallel",           ConstraintBase::PARALLEL, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.line[0]; c->entityB = k.line[1]; } },
+    { "perpendicular",      ConstraintBase::PERPENDICULAR, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.line[0]; c->entityB = k.line[1]; } },
+    { "arc-line-tangent",   ConstraintBase::ARC_LINE_TANGENT, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.arc[0]; c->entityB = k.line[0]; } },
+    { "cubic-line-tangent", ConstraintBase::CUBIC_LINE_TANGENT, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.cubic; c->entityB = k.line[0]; } },
+    { "curve-curve-tangent", ConstraintBase::CURVE_CURVE_TANGENT, false,
+        [](ConstraintBase *c, const Kit &k) { c->entityA = k.arc[0]; c->entityB = k.arc[1]; } },
+    { "where-dragged",      ConstraintBase::WHERE_DRAGGED, false,
+        [](ConstraintBase *c, const Kit &k) { c->ptA = k.pt[0]; } },
+};
+
+static void Setup(void) {
+    SK.param.Clear();
+    SK.entity.Clear();
+    SK.constraint.Clear();
+    NextParam = 1;
+    NextEntity = 1;
+
+    hEntity origin = AddPoint3d(0, 0, 0);
+    hEntity normal = AddNormal3d(Quaternion::From(1, 0, 0, 0));
+
+    EntityBase wp = {};
+    wp.type = EntityBase::WORKPLANE;
+    wp.point[0] = origin;
+    wp.normal = normal;
+    Workplane = AddEntity(&wp);
+
+    EntityBase n = {};
+    n.type = EntityBase::NORMAL_IN_2D;
+    n.workplane = Workplane;
+    Normal2d = AddEntity(&n);
+}
+
+static void Run(const Case *cs) {
+    Setup();
+    int i;
+    for(i = 0; i < COPIES; i++) {
+        Kit k = MakeKit(i);
+        ConstraintBase c = {};
+        c.h.v = (uint32_t)(i + 1);
+        c.type = cs->type;
+        c.workplane = cs->in3d ? EntityBase::FREE_IN_3D : Workplane;
+        c.valA = 10;
+        cs->fill(&c, k);
+        SK.constraint.Add(&c);
+    }
+
+    IdList<Equation,hEquation> eqs = {};
+    for(i = 0; i < SK.constraint.n; i++) {
+        SK.constraint.elem[i].Generate(&eqs);
+    }
+    std::vector<Expr *> fs;
+    for(i = 0; i < eqs.n; i++) {
+        Expr *f = eqs.elem[i].e->DeepCopyWithParamsAsPointers(&SK.param, &SK.param);
+        fs.push_back(f->FoldConstants());
+    }
+
+    // The symbolic way: write out each partial, simplify it, and compile it.
+    double t0 = Now();
+    ExprTape sym = {};
+    std::vector<std::vector<int>> symSlot(fs.size());
+    std::vector<std::vector<hParam>> used(fs.size());
+    for(size_t r = 0; r < fs.size(); r++) {
+        fs[r]->ParamsUsedList(&used[r]);
+        std::sort(used[r].begin(), used[r].end(),
+            [](hParam a, hParam b) { return a.v < b.v; });
+        used[r].erase(std::unique(used[r].begin(), used[r].end(),
+            [](hParam a, hParam b) { return a.v == b.v; }), used[r].end());
+        for(hParam hp : used[r]) {
+            Expr *pd = fs[r]->PartialWrt(hp)->FoldConstants();
+            pd = pd->DeepCopyWithParamsAsPointers(&SK.param, &SK.param);
+            symSlot[r].push_back(sym.Add(pd));
+        }
+    }
+    sym.DoneAdding();
+    double t1 = Now();
+    for(int n = 0; n < EVALS; n++) sym.Run();
+    double t2 = Now();
+
+    // And in reverse mode, straight from the equations.
+    ExprTape ad = {};
+    std::vector<std::vector<int>> adSlot(fs.size());
+    for(size_t r = 0; r < fs.size(); r++) {
+        ad.AddOutput(fs[r]);
+    }
+    for(size_t r = 0; r < fs.size(); r++) {
+        for(hParam hp : used[r]) {
+            adSlot[r].push_back(ad.SlotOfParam(SK.GetParam(hp)));
+        }
+    }
+    ad.DoneAdding();
+    double t3 = Now();
+    double maxErr = 0;
+    for(int n = 0; n < EVALS; n++) {
+        ad.Run();
+        for(size_t r = 0; r < fs.size(); r++) {
+            ad.Reverse((int)r);
+            if(n != 0) continue;
+            for(size_t j = 0; j < adSlot[r].size(); j++) {
+                double err = fabs(ad.adj[adSlot[r][j]] - sym.slot[symSlot[r][j]]);
+                if(!(err <= maxErr)) maxErr = err;
+            }
+        }
+    }
+    double t4 = Now();
+
+    printf("%-20s %6d %9.2f %9.2f %9.2f %9.2f %9.2e\n",
+        cs->name, eqs.n,
+        (t1 - t0)*1e3, (t2 - t1)*1e3/EVALS,
+        (t3 - t2)*1e3, (t4 - t3)*1e3/EVALS, maxErr);
+
+    eqs.Clear();
+    FreeAllTemporary();
+}
+
+int main(int argc, char **argv) {
+    InitHeaps();
+
+    printf("%d copies of each; times in ms\n", COPIES);
+    printf("%-20s %6s %9s %9s %9s %9s %9s\n", "constraint", "eqs",
+        "sym write", "sym eval", "ad write", "ad eval", "max diff");
+    for(const Case &cs : Cases) {
+        if(argc > 1 && strcmp(argv[1], cs.name)) continue;
+        Run(&cs);
+    }
+    return 0;
+}
@@ -0,0 +1,134 @@
+//-----------------------------------------------------------------------------
+// Benchmark for hidden line removal in the vector export: the time to split
+// the edges of a mesh against that mesh with SOcclusionBvh, on one thread
+// and on all of them, against testing every edge against every triangle.
+//-----------------------------------------------------------------------------
+#include <chrono>
+#include "solvespace.h"
+
+using namespace SolveSpace;
+
+static double Now(void) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// A k by k grid of overlapping spheres of radius 10 mm, each as an n by 2n
+// grid in latitude and longitude, seen along z. The edges to test are the
+// lines of latitude and longitude, so that most of them are partly hidden.
+static void MakeSpheres(SMesh *sm, SEdgeList *sel, int k, int n) {
+    STriMeta meta = {};
+    for(int si = 0; si < k; si++) {
+        for(int sj = 0; sj < k; sj++) {
+            Vector o = Vector::From(15*si, 15*sj, 5*((si + sj) % 3));
+            auto at = [&](int i, int j) {
+                double th = PI*i/n, ph = PI*j/n;
+                return o.Plus(Vector::From(10*sin(th)*cos(ph),
+                                           10*sin(th)*sin(ph),
+                                           10*cos(th)));
+            };
+            for(int i = 0; i < n; i++) {
+                for(int j = 0; j < 2*n; j++) {
+                    Vector a = at(i, j),     b = at(i + 1, j),
+                           c = at(i + 1, j + 1), d = at(i, j + 1);
+                    STriangle abc = STriangle::From(meta, a, b, c),
+                              acd = STriangle::From(meta, a, c, d);
+                    if(i != n - 1) sm->l.Add(&abc);
+                    if(i != 0)     sm->l.Add(&acd);
+                    if(i != 0)     sel->AddEdge(a, d);
+                    sel->AddEdge(a, b);
+                }
+            }
+        }
+    }
+}
+
+static double LengthOf(std::vector<SEdgeList> *visible) {
+    double len = 0;
+    for(SEdgeList &edges : *visible) {
+        SEdge *se;
+        for(se = edges.l.First(); se; se = edges.l.NextAfter(se)) {
+            len += (se->b).Minus(se->a).Magnitude();
+        }
+    }
+    return len;
+}
+
+static void ClearAll(std::vector<SEdgeList> *visible) {
+    for(SEdgeList &edges : *visible) edges.Clear();
+}
+
+// Test every edge against every front-facing triangle; to check that the BVH
+// doesn't miss any triangle that hides something.
+static double TimeAll(SMesh *sm, SEdgeList *sel, double *len) {
+    std::vector<SEdgeList> visible(sel->l.n);
+    double t0 = Now();
+    std::vector<STriangle> tris;
+    for(int i = 0; i < sm->l.n; i++) {
+        STriangle *tr = &(sm->l.elem[i]);
+        if(tr->Normal().WithMagnitude(1).z > LENGTH_EPS) tris.push_back(*tr);
+    }
+    for(int i = 0; i < sel->l.n; i++) {
+        SEdge *se = &(sel->l.elem[i]);
+        visible[i].AddEdge(se->a, se->b, se->auxA);
+        for(STriangle &tr : tris) {
+            SOcclusionBvh::SplitLinesAgainstTriangle(&visible[i], &tr, true);
+        }
+        visible[i].MergeCollinearSegments(se->a, se->b);
+    }
+    double t = Now() - t0;
+    *len = LengthOf(&visible);
+    ClearAll(&visible);
+    return t;
+}
+
+static double TimeNew(SMesh *sm, SEdgeList *sel, int threads, double *len) {
+    std::vector<SEdgeList> visible(sel->l.n);
+    double t0 = Now();
+    SOcclusionBvh bvh = {};
+    bvh.Build(sm);
+    ParallelFor(sel->l.n, threads, [&](int i) {
+        SEdge *se = &(sel->l.elem[i]);
+        visible[i].AddEdge(se->a, se->b, se->auxA);
+        bvh.OcclusionTestLine(*se, &visible[i], true);
+        visible[i].MergeCollinearSegments(se->a, se->b);
+    });
+    bvh.Clear();
+    double t = Now() - t0;
+    *len = LengthOf(&visible);
+    ClearAll(&visible);
+    return t;
+}
+
+int main(int argc, char **argv) {
+    InitHeaps();
+
+    int threads = CpuCount();
+    printf("times in ms to remove the hidden lines from k*k spheres of "
+           "n*2n cells, against all the triangles and with the BVH on 1 and "
+           "on %d threads; and the visible length of the edges, in mm\n",
+           threads);
+    printf("%3s %4s %8s %8s %8s %8s %8s %10s\n",
+        "k", "n", "tris", "edges", "all", "bvh", "bvh-par", "length");
+    for(int k : { 2, 3 }) {
+        for(int n : { 8, 16 }) {
+            SMesh sm = {};
+            SEdgeList sel = {};
+            MakeSpheres(&sm, &sel, k, n);
+
+            double lAll, lNew, lPar;
+            double tAll = TimeAll(&sm, &sel, &lAll);
+            double tNew = TimeNew(&sm, &sel, 1, &lNew);
+            double tPar = TimeNew(&sm, &sel, threads, &lPar);
+            // The triangles are tested in a different order, which can
+            // change where an edge gets split, but not what's visible.
+            if(fabs(lAll - lNew) > 1e-6*lAll || lPar != lNew) oops();
+
+            printf("%3d %4d %8d %8d %8.1f %8.1f %8.1f %10.1f\n",
+                k, n, sm.l.n, sel.l.n, tAll*1e3, tNew*1e3, tPar*1e3, lNew);
+            sm.l.Clear();
+            sel.Clear();
+        }
+    }
+    return 0;
+}
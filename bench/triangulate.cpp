@@ -0,0 +1,404 @@
+//-----------------------------------------------------------------------------
+// Benchmark for SPolygon::MonotoneTriangulateInto: the time to triangulate
+// planar faces with many points or many holes, like imported outlines, text,
+// or a perforated plate, against the bridging and ear clipping that was the
+// only way to triangulate a plane before.
+//-----------------------------------------------------------------------------
+#include <chrono>
+#include "solvespace.h"
+
+using namespace SolveSpace;
+
+static double Now(void) {
+    return std::chrono::duration<double>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The ear clipping is quadratic or worse in the number of points, so only
+// run it while it's still quick.
+static const int MAX_EAR_CLIPPING = 20000;
+
+static const double EPS = LENGTH_EPS;
+
+// A copy of the planar case of SContour::BridgeToContour, IsEar, ClipEarInto
+// and UvTriangulateInto, and of SPolygon::UvTriangulateInto.
+static bool BridgeToContour(SContour *dest, SContour *sc,
+                            SEdgeList *avoidEdges, List<Vector> *avoidPts)
+{
+    int i, j;
+
+    int sco = 0;
+    for(i = 0; i < (sc->l.n - 1); i++) {
+        if((sc->l.elem[i].p).EqualsExactly(sc->xminPt)) {
+            sco = i;
+        }
+    }
+
+    int thiso = 0;
+    double dmin = 1e10;
+    for(i = 0; i < dest->l.n; i++) {
+        Vector p = dest->l.elem[i].p;
+        double d = (p.Minus(sc->xminPt)).MagSquared();
+        if(d < dmin) {
+            dmin = d;
+            thiso = i;
+        }
+    }
+
+    int thisp, scp;
+    Vector a, b, *f;
+
+    for(i = 0; i < dest->l.n; i++) {
+        thisp = WRAP(i+thiso, dest->l.n);
+        a = dest->l.elem[thisp].p;
+
+        for(f = avoidPts->First(); f; f = avoidPts->NextAfter(f)) {
+            if(f->Equals(a)) break;
+        }
+        if(f) continue;
+
+        for(j = 0; j < (sc->l.n - 1); j++) {
+            scp = WRAP(j+sco, (sc->l.n - 1));
+            b = sc->l.elem[scp].p;
+
+            if(a.Equals(b)) {
+                goto haveEdge;
+            }
+        }
+    }
+
+    for(i = 0; i < dest->l.n; i++) {
+        thisp = WRAP(i+thiso, dest->l.n);
+        a = dest->l.elem[thisp].p;
+
+        for(f = avoidPts->First(); f; f = avoidPts->NextAfter(f)) {
+            if(f->Equals(a)) break;
+        }
+        if(f) continue;
+
+        for(j = 0; j < (sc->l.n - 1); j++) {
+            scp = WRAP(j+sco, (sc->l.n - 1));
+            b = sc->l.elem[scp].p;
+
+            for(f = avoidPts->First(); f; f = avoidPts->NextAfter(f)) {
+                if(f->Equals(b)) break;
+            }
+            if(f) continue;
+
+            if(avoidEdges->AnyEdgeCrossings(a, b) == 0) {
+                goto haveEdge;
+            }
+        }
+    }
+    return false;
+
+haveEdge:
+    SContour merged = {};
+    for(i = 0; i < dest->l.n; i++) {
+        merged.AddPoint(dest->l.elem[i].p);
+        if(i == thisp) {
+            for(j = 0; j <= (sc->l.n - 1); j++) {
+                int jp = WRAP(j + scp, (sc->l.n - 1));
+                merged.AddPoint((sc->l.elem[jp]).p);
+            }
+            merged.AddPoint(dest->l.elem[i].p);
+        }
+    }
+
+    avoidEdges->AddEdge(a, b);
+    avoidPts->Add(&a);
+    avoidPts->Add(&b);
+
+    dest->l.Clear();
+    dest->l = merged.l;
+    return true;
+}
+
+static bool IsEar(SContour *sc, int bp) {
+    int ap = WRAP(bp-1, sc->l.n),
+        cp = WRAP(bp+1, sc->l.n);
+
+    STriangle tr = {};
+    tr.a = sc->l.elem[ap].p;
+    tr.b = sc->l.elem[bp].p;
+    tr.c = sc->l.elem[cp].p;
+
+    if((tr.a).Equals(tr.c)) return true;
+
+    Vector n = Vector::From(0, 0, -1);
+    if((tr.Normal()).Dot(n) < EPS) return false;
+
+    Vector maxv = tr.a, minv = tr.a;
+    (tr.b).MakeMaxMin(&maxv, &minv);
+    (tr.c).MakeMaxMin(&maxv, &minv);
+
+    for(int i = 0; i < sc->l.n; i++) {
+        if(i == ap || i == bp || i == cp) continue;
+
+        Vector p = sc->l.elem[i].p;
+        if(p.OutsideAndNotOn(maxv, minv)) continue;
+
+        if(p.EqualsExactly(tr.a)) continue;
+        if(p.EqualsExactly(tr.b)) continue;
+        if(p.EqualsExactly(tr.c)) continue;
+
+        if(tr.ContainsPointProjd(n, p)) return false;
+    }
+    return true;
+}
+
+static void ClipEarInto(SContour *sc, List<STriangle> *tl, int bp) {
+    int ap = WRAP(bp-1, sc->l.n),
+        cp = WRAP(bp+1, sc->l.n);
+
+    STriangle tr = {};
+    tr.a = sc->l.elem[ap].p;
+    tr.b = sc->l.elem[bp].p;
+    tr.c = sc->l.elem[cp].p;
+    if(tr.Normal().MagSquared() >= EPS*EPS) {
+        tl->Add(&tr);
+    }
+
+    sc->l.elem[ap].ear = SPoint::UNKNOWN;
+    sc->l.elem[cp].ear = SPoint::UNKNOWN;
+
+    sc->l.ClearTags();
+    sc->l.elem[bp].tag = 1;
+    sc->l.RemoveTagged();
+}
+
+static bool EarClipInto(SContour *sc, List<STriangle> *tl) {
+    int i;
+    sc->l.ClearTags();
+    for(i = 1; i < sc->l.n; i++) {
+       if((sc->l.elem[i].p).Equals(sc->l.elem[i-1].p)) {
+            sc->l.elem[i].tag = 1;
+        }
+    }
+    sc->l.RemoveTagged();
+
+    for(i = 0; i < sc->l.n; i++) {
+        sc->l.elem[i].ear = IsEar(sc, i) ? SPoint::EAR : SPoint::NOT_EAR;
+    }
+
+    bool toggle = false;
+    while(sc->l.n > 3) {
+        for(i = 0; i < sc->l.n; i++) {
+            if(sc->l.elem[i].ear == SPoint::UNKNOWN) {
+                sc->l.elem[i].ear = IsEar(sc, i) ?
+                                        SPoint::EAR : SPoint::NOT_EAR;
+            }
+        }
+
+        int bestEar = -1;
+        toggle = !toggle;
+        int offset = toggle ? -1 : 0;
+        for(i = 0; i < sc->l.n; i++) {
+            int ear = WRAP(i+offset, sc->l.n);
+            if(sc->l.elem[ear].ear == SPoint::EAR) {
+                bestEar = ear;
+                break;
+            }
+        }
+        if(bestEar < 0) return false;
+        ClipEarInto(sc, tl, bestEar);
+    }
+
+    ClipEarInto(sc, tl, 0);
+    return true;
+}
+
+static bool EarClipPolygonInto(SPolygon *sp, List<STriangle> *tl) {
+    sp->normal = Vector::From(0, 0, 1);
+
+    while(sp->l.n > 0) {
+        sp->FixContourDirections();
+        sp->l.ClearTags();
+
+        SContour *top;
+        for(top = sp->l.First(); top; top = sp->l.NextAfter(top)) {
+            if(top->timesEnclosed == 0) break;
+        }
+        if(!top) return false;
+
+        SContour merged = {};
+        top->tag = 1;
+        top->CopyInto(&merged);
+        (merged.l.n)--;
+
+        SEdgeList el = {};
+        top->MakeEdgesInto(&el);
+        List<Vector> vl = {};
+
+        SContour *sc;
+        for(sc = sp->l.First(); sc; sc = sp->l.NextAfter(sc)) {
+            if(sc->timesEnclosed != 1) continue;
+            if(sc->l.n < 2) continue;
+
+            Vector tp = sc->AnyEdgeMidpoint();
+            if(top->ContainsPointProjdToNormal(sp->normal, tp)) {
+                sc->tag = 2;
+                sc->MakeEdgesInto(&el);
+                sc->FindPointWithMinX();
+            }
+        }
+
+        for(;;) {
+            double xmin = 1e10;
+            SContour *scmin = NULL;
+
+            for(sc = sp->l.First(); sc; sc = sp->l.NextAfter(sc)) {
+                if(sc->tag != 2) continue;
+
+                if(sc->xminPt.x < xmin) {
+                    xmin = sc->xminPt.x;
+                    scmin = sc;
+                }
+            }
+            if(!scmin) break;
+
+            if(!BridgeToContour(&merged, scmin, &el, &vl)) return false;
+            scmin->tag = 3;
+        }
+
+        bool ok = EarClipInto(&merged, tl);
+        merged.l.Clear();
+        el.Clear();
+        vl.Clear();
+        if(!ok) return false;
+
+        for(sc = sp->l.First(); sc; sc = sp->l.NextAfter(sc)) {
+            if(sc->tag) {
+                sc->l.Clear();
+            }
+        }
+        sp->l.RemoveTagged();
+    }
+    return true;
+}
+
+static void AddCircle(SPolygon *sp, Vector c, double r, int n, bool hole) {
+    sp->AddEmptyContour();
+    SContour *sc = &(sp->l.elem[sp->l.n - 1]);
+    for(int i = 0; i <= n; i++) {
+        double a = 2*PI*(i % n)/n;
+        if(hole) a = -a;
+        sc->AddPoint(c.Plus(Vector::From(r*cos(a), r*sin(a), 0)));
+    }
+}
+
+// A square plate, drilled with a k by k grid of holes of n sides each.
+static void MakePlate(SPolygon *sp, int k, int n) {
+    sp->AddEmptyContour();
+    SContour *sc = &(sp->l.elem[0]);
+    double w = 10.0*k;
+    Vector corners[] = {
+        Vector::From(0, 0, 0), Vector::From(w, 0, 0),
+        Vector::From(w, w, 0), Vector::From(0, w, 0), Vector::From(0, 0, 0),
+    };
+    for(Vector &p : corners) sc->AddPoint(p);
+
+    for(int i = 0; i < k; i++) {
+        for(int j = 0; j < k; j++) {
+            AddCircle(sp, Vector::From(5 + 10*i, 5 + 10*j, 0), 3, n, true);
+        }
+    }
+}
+
+// Rows of letter-like outlines, each an 'o': an outline with one hole, a
+// little off centre.
+static void MakeText(SPolygon *sp, int k, int n) {
+    for(int i = 0; i < k; i++) {
+        for(int j = 0; j < k; j++) {
+            Vector c = Vector::From(6*i + 0.3*(j % 3), 9*j + 0.2*(i % 5), 0);
+            AddCircle(sp, c, 2.5, n, false);
+            AddCircle(sp, c.Plus(Vector::From(0.1, 0.05, 0)), 1.5, n, true);
+        }
+    }
+}
+
+// One big outline, a gear with n teeth, so that half its vertices are reflex.
+static void MakeGear(SPolygon *sp, int n) {
+    sp->AddEmptyContour();
+    SContour *sc = &(sp->l.elem[0]);
+    for(int i = 0; i <= 4*n; i++) {
+        double a = 2*PI*(i % (4*n))/(4*n);
+        double r = ((i/2) % 2) ? 95 : 100;
+        sc->AddPoint(Vector::From(r*cos(a), r*sin(a), 0));
+    }
+}
+
+static int CountPoints(SPolygon *sp) {
+    int n = 0;
+    for(int i = 0; i < sp->l.n; i++) n += sp->l.elem[i].l.n - 1;
+    return n;
+}
+
+static double AreaOf(List<STriangle> *tl) {
+    double area = 0;
+    for(int i = 0; i < tl->n; i++) {
+        STriangle *tr = &(tl->elem[i]);
+        // Both triangulators wind their triangles clockwise.
+        if(tr->Normal().z > 0) oops();
+        area += tr->Normal().Magnitude()/2;
+    }
+    return area;
+}
+
+// Any triangulation of o outlines with h holes in them, and n points in all,
+// has n + 2h - 2o triangles, if no three points lie in a line.
+static void Run(const char *what, SPolygon *sp, int outlines, int holes) {
+    int points = CountPoints(sp);
+    // The outlines are made with their holes wound backwards, so this is
+    // the true area.
+    sp->normal = Vector::From(0, 0, 1);
+    double area = fabs(sp->SignedArea());
+
+    List<STriangle> tl = {};
+    double t0 = Now();
+    bool ok = sp->MonotoneTriangulateInto(&tl, EPS);
+    double tSweep = Now() - t0;
+    if(!ok || fabs(AreaOf(&tl) - area) > 1e-6*area) oops();
+    int tris = tl.n;
+    if(tris != points + 2*holes - 2*outlines) oops();
+    tl.Clear();
+
+    double tEars = -1;
+    if(points <= MAX_EAR_CLIPPING) {
+        t0 = Now();
+        ok = EarClipPolygonInto(sp, &tl);
+        tEars = Now() - t0;
+        if(!ok || fabs(AreaOf(&tl) - area) > 1e-6*area) oops();
+        tl.Clear();
+    }
+
+    if(tEars >= 0) {
+        printf("%-6s %8d %8d %9.2f %9.2f\n", what, points, tris,
+            tSweep*1e3, tEars*1e3);
+    } else {
+        printf("%-6s %8d %8d %9.2f %9s\n", what, points, tris,
+            tSweep*1e3, "-");
+    }
+    sp->Clear();
+}
+
+int main(int argc, char **argv) {
+    InitHeaps();
+
+    printf("times in ms, to triangulate a polygon with n points\n");
+    printf("%-6s %8s %8s %9s %9s\n", "", "n", "tris", "sweep", "ears");
+    SPolygon sp = {};
+    for(int k : { 4, 8, 16, 32, 64 }) {
+        MakePlate(&sp, k, 24);
+        Run("plate", &sp, 1, k*k);
+    }
+    for(int k : { 4, 8, 16, 32, 64 }) {
+        MakeText(&sp, k, 16);
+        Run("text", &sp, k*k, k*k);
+    }
+    for(int n : { 256, 1024, 4096, 16384, 65536 }) {
+        MakeGear(&sp, n);
+        Run("gear", &sp, 1, 0);
+    }
+    return 0;
+}
@@ -88,6 +88,12 @@ void TextWindow::ScreenChangeCheckClosedContour(int link, uint32_t v) {
     InvalidateGraphics();
 }
 
+void TextWindow::ScreenChangeMonotoneTriangulation(int link, uint32_t v) {
+    SS.monotoneTriangulation = !SS.monotoneTriangulation;
+    SS.GenerateAll(SolveSpaceUI::GENERATE_ALL);
+    InvalidateGraphics();
+}
+
 void TextWindow::ScreenChangeShadedTriangles(int link, uint32_t v) {
     SS.exportShadedTriangles = !SS.exportShadedTriangles;
     InvalidateGraphics();
@@ -160,6 +166,11 @@ void TextWindow::ScreenChangeAutosaveInterval(int link, uint32_t v) {
     SS.TW.edit.meaning = EDIT_AUTOSAVE_INTERVAL;
 }
 
+void TextWindow::ScreenChangeWorkerThreads(int link, uint32_t v) {
+    SS.TW.ShowEditControl(3, std::to_string(SS.workerThreads));
+    SS.TW.edit.meaning = EDIT_WORKER_THREADS;
+}
+
 void TextWindow::ShowConfiguration(void) {
     int i;
     Printf(true, "%Ft user color (r, g, b)");
@@ -296,6 +307,9 @@ void TextWindow::ShowConfiguration(void) {
     Printf(false, "  %Fd%f%Ll%s  check sketch for closed contour%E",
         &ScreenChangeCheckClosedContour,
         SS.checkClosedContour ? CHECK_TRUE : CHECK_FALSE);
+    Printf(false, "  %Fd%f%Ll%s  triangulate planar faces by sweep line%E",
+        &ScreenChangeMonotoneTriangulation,
+        SS.monotoneTriangulation ? CHECK_TRUE : CHECK_FALSE);
 
     Printf(false, "");
     Printf(false, "%Ft autosave interval (in minutes)%E");
@@ -303,6 +317,24 @@ void TextWindow::ShowConfiguration(void) {
         SS.autosaveInterval, &ScreenChangeAutosaveInterval);
 
     Printf(false, "");
+    Printf(false, "%Ft worker threads (0 for one per core)%E");
+    Printf(false, "%Ba   %d %Fl%Ll%f[change]%E",
+        SS.workerThreads, &ScreenChangeWorkerThreads);
+
+    Printf(false, "");
+    Printf(false, " %Ftlast regen  %E%s MB temporary in %s allocations",
+        ssprintf("%.1f", SS.regenTemporary.bytes / (1024.0*1024.0)).c_str(),
+        ssprintf("%llu", (unsigned long long)SS.regenTemporary.allocs).c_str());
+    Printf(false, " %Ft   surfaces %E%s of %s pairs tested, %s intersected, %d ms",
+        ssprintf("%llu", (unsigned long long)SS.regenBoolean.tested).c_str(),
+        ssprintf("%llu", (unsigned long long)SS.regenBoolean.pairs).c_str(),
+        ssprintf("%llu", (unsigned long long)SS.regenBoolean.intersected).c_str(),
+        (int)SS.regenBoolean.ms);
+    Printf(false, " %Ft   time     %E%d ms solving, %d ms in Booleans, "
+                  "%d ms triangulating",
+        (int)SS.regenMs.solve, (int)SS.regenMs.boolean,
+        (int)SS.regenMs.triangulate);
+    Printf(false, "");
     Printf(false, " %Ftgl vendor   %E%s", glGetString(GL_VENDOR));
     Printf(false, " %Ft   renderer %E%s", glGetString(GL_RENDERER));
     Printf(false, " %Ft   version  %E%s", glGetString(GL_VERSION));
@@ -441,6 +473,19 @@ bool TextWindow::EditControlDoneForConfiguration(const char *s) {
             if(e) SS.gCode.plungeFeed = (float)SS.ExprToMm(e);
             break;
         }
+        case EDIT_WORKER_THREADS: {
+            int threads;
+            if(sscanf(s, "%d", &threads)==1) {
+                if(threads >= 0) {
+                    SS.workerThreads = threads;
+                } else {
+                    Error("Bad value: worker threads should not be negative");
+                }
+            } else {
+                Error("Bad format: specify a whole number of threads");
+            }
+            break;
+        }
         case EDIT_AUTOSAVE_INTERVAL: {
             int interval;
             if(sscanf(s, "%d", &interval)==1) {
@@ -235,8 +235,8 @@ public:
 };
 
 // A list, where each element has an integer identifier. The list is kept
-// sorted by that identifier, and items can be looked up in log n time by
-// id.
+// sorted by that identifier, and items can be looked up in constant time by
+// id, through a hash table from id to position in the list.
 template <class T, class H>
 class IdList {
 public:
@@ -244,14 +244,58 @@ public:
     int   n;
     int   elemsAllocated;
 
-    uint32_t MaximumId(void) {
-        uint32_t id = 0;
+    // An open-addressed hash table of positions in elem, with -1 for an
+    // empty slot; indexSize is a power of two, or zero for small lists that
+    // just use a binary search.
+    int   *index;
+    int   indexSize;
 
-        int i;
-        for(i = 0; i < n; i++) {
-            id = max(id, elem[i].h.v);
+    // Bumped whenever elements are added or removed, so that anything
+    // derived from the list can tell if it's out of date.
+    uint32_t generation;
+
+    enum { INDEX_MIN = 64 };
+
+    static uint32_t HashOf(uint32_t v) {
+        v *= 0x9e3779b1u;
+        return v ^ (v >> 16);
+    }
+
+    void IndexInsert(int i) {
+        uint32_t mask = (uint32_t)indexSize - 1;
+        uint32_t s = HashOf(elem[i].h.v) & mask;
+        while(index[s] >= 0) s = (s + 1) & mask;
+        index[s] = i;
+    }
+
+    // The element at position to was at position from.
+    void IndexMoved(int from, int to) {
+        uint32_t mask = (uint32_t)indexSize - 1;
+        uint32_t s = HashOf(elem[to].h.v) & mask;
+        while(index[s] != from) s = (s + 1) & mask;
+        index[s] = to;
+    }
+
+    void Reindex(void) {
+        if(n < INDEX_MIN) {
+            if(index) MemFree(index);
+            index = NULL;
+            indexSize = 0;
+            return;
         }
-        return id;
+        if(indexSize < 2*n || indexSize > 16*n) {
+            // Leave room for the list to double before we do this again.
+            if(index) MemFree(index);
+            indexSize = 1;
+            while(indexSize < 4*n) indexSize *= 2;
+            index = (int *)MemAlloc((size_t)indexSize*sizeof(index[0]));
+        }
+        for(int s = 0; s < indexSize; s++) index[s] = -1;
+        for(int i = 0; i < n; i++) IndexInsert(i);
+    }
+
+    uint32_t MaximumId(void) {
+        return (n == 0) ? 0 : elem[n - 1].h.v;
     }
 
     H AddAndAssignId(T *t) {
@@ -273,7 +317,14 @@ public:
             elem = newElem;
         }
 
+        // Everything that uses the list expects elem in order of id, so we
+        // keep it sorted as we go; adding out of order moves the rest of the
+        // list up, so it's O(n).
         int first = 0, last = n;
+        if(n > 0 && elem[n - 1].h.v < t->h.v) {
+            // The usual case, with the ids in increasing order
+            first = last = n;
+        }
         // We know that we must insert within the closed interval [first,last]
         while(first != last) {
             int mid = (first + last)/2;
@@ -289,10 +340,20 @@ public:
         }
 
         int i = first;
+        generation++;
         new(&elem[n]) T();
         std::move_backward(elem + i, elem + n, elem + n + 1);
         elem[i] = *t;
         n++;
+
+        if(index && 2*n <= indexSize) {
+            for(int j = n - 1; j > i; j--) {
+                IndexMoved(j - 1, j);
+            }
+            IndexInsert(i);
+        } else if(n >= INDEX_MIN) {
+            Reindex();
+        }
     }
 
     T *FindById(H h) {
@@ -305,6 +366,15 @@ public:
     }
 
     int IndexOf(H h) {
+        if(index) {
+            uint32_t mask = (uint32_t)indexSize - 1;
+            uint32_t s = HashOf(h.v) & mask;
+            for(; index[s] >= 0; s = (s + 1) & mask) {
+                if(elem[index[s]].h.v == h.v) return index[s];
+            }
+            return -1;
+        }
+
         int first = 0, last = n-1;
         while(first <= last) {
             int mid = (first + last)/2;
@@ -321,19 +391,8 @@ public:
     }
 
     T *FindByIdNoOops(H h) {
-        int first = 0, last = n-1;
-        while(first <= last) {
-            int mid = (first + last)/2;
-            H hm = elem[mid].h;
-            if(hm.v > h.v) {
-                last = mid-1; // and first stays the same
-            } else if(hm.v < h.v) {
-                first = mid+1; // and last stays the same
-            } else {
-                return &(elem[mid]);
-            }
-        }
-        return NULL;
+        int i = IndexOf(h);
+        return (i < 0) ? NULL : &(elem[i]);
     }
 
     T *First(void) {
@@ -377,7 +436,9 @@ public:
         for(int i = dest; i < n; i++)
             elem[i].~T();
         n = dest;
+        generation++;
         // and elemsAllocated is untouched, because we didn't resize
+        if(index) Reindex();
     }
     void RemoveById(H h) {
         ClearTags();
@@ -387,9 +448,14 @@ public:
 
     void MoveSelfInto(IdList<T,H> *l) {
         l->Clear();
+        uint32_t lGeneration = l->generation;
         *l = *this;
+        l->generation = lGeneration;
+        generation++;
         elemsAllocated = n = 0;
         elem = NULL;
+        indexSize = 0;
+        index = NULL;
     }
 
     void DeepCopyInto(IdList<T,H> *l) {
@@ -399,6 +465,8 @@ public:
             new(&l->elem[i]) T(elem[i]);
         l->elemsAllocated = elemsAllocated;
         l->n = n;
+        l->generation++;
+        l->Reindex();
     }
 
     void Clear(void) {
@@ -409,6 +477,10 @@ public:
         elemsAllocated = n = 0;
         if(elem) MemFree(elem);
         elem = NULL;
+        if(index) MemFree(index);
+        index = NULL;
+        indexSize = 0;
+        generation++;
     }
 
 };
@@ -327,36 +327,40 @@ void SolveSpaceUI::ExportLinesAndMesh(SEdgeList *sel, SBezierList *sbl, SMesh *s
     // And now we perform hidden line removal if requested
     SEdgeList hlrd = {};
     if(sm) {
-        SKdNode *root = SKdNode::From(&smp);
-
         // Generate the edges where a curved surface turns from front-facing
         // to back-facing.
         if(SS.GW.showEdges) {
-            root->MakeCertainEdgesInto(sel, SKdNode::TURNING_EDGES,
-                                       /*coplanarIsInter=*/false, NULL, NULL,
-                                       GW.showOutlines ? Style::OUTLINE : Style::SOLID_EDGE);
+            SIndexedMesh im = {};
+            im.MakeFromMesh(&smp, /*withNormals=*/false);
+            im.MakeCertainEdgesInto(sel, SKdNode::TURNING_EDGES,
+                                    GW.showOutlines ? Style::OUTLINE : Style::SOLID_EDGE);
+            im.Clear();
         }
 
-        root->ClearTags();
-        int cnt = 1234;
-
-        SEdge *se;
-        for(se = sel->l.First(); se; se = sel->l.NextAfter(se)) {
-            if(se->auxA == Style::CONSTRAINT) {
-                // Constraints should not get hidden line removed; they're
-                // always on top.
-                hlrd.AddEdge(se->a, se->b, se->auxA);
-                continue;
-            }
+        SOcclusionBvh bvh = {};
+        bvh.Build(&smp);
+
+        // Each edge is split against the mesh on its own, so do them all in
+        // parallel, and then collect what's left of them in order.
+        bool removeHidden = !SS.GW.showHdnLines;
+        std::vector<SEdgeList> visible(sel->l.n);
+        ParallelFor(sel->l.n, GetWorkerThreads(), [&](int i) {
+            SEdge *se = &(sel->l.elem[i]);
+            SEdgeList *edges = &visible[i];
+            edges->AddEdge(se->a, se->b, se->auxA);
+            // Constraints should not get hidden line removed; they're
+            // always on top.
+            if(se->auxA == Style::CONSTRAINT) return;
 
-            SEdgeList edges = {};
             // Split the original edge against the mesh
-            edges.AddEdge(se->a, se->b, se->auxA);
-            root->OcclusionTestLine(*se, &edges, cnt, /*removeHidden=*/!SS.GW.showHdnLines);
+            bvh.OcclusionTestLine(*se, edges, removeHidden);
             // the occlusion test splits unnecessarily; so fix those
-            edges.MergeCollinearSegments(se->a, se->b);
-            cnt++;
-            // And add the results to our output
+            edges->MergeCollinearSegments(se->a, se->b);
+        });
+        bvh.Clear();
+
+        // And add the results to our output
+        for(SEdgeList &edges : visible) {
             SEdge *sen;
             for(sen = edges.l.First(); sen; sen = edges.l.NextAfter(sen)) {
                 hlrd.AddEdge(sen->a, sen->b, sen->auxA);
@@ -727,7 +731,9 @@ void VectorFileWriter::BezierAsNonrationalCubic(SBezier *sb, int depth) {
 //-----------------------------------------------------------------------------
 void SolveSpaceUI::ExportMeshTo(const std::string &filename) {
     SS.exportMode = true;
-    GenerateAll(GENERATE_ALL);
+    // The groups after the active one don't go into its mesh, so don't
+    // bother to regenerate them at the export tolerance.
+    GenerateAll(GENERATE_UNTIL_ACTIVE);
 
     Group *g = SK.GetGroup(SS.GW.activeGroup);
     g->GenerateDisplayItems();
@@ -744,10 +750,13 @@ void SolveSpaceUI::ExportMeshTo(const std::string &filename) {
         return;
     }
 
+    MeshFileWriter mfw = {};
+    mfw.f = f;
+    mfw.scale = SS.exportScale;
     if(FilenameHasExtension(filename, ".stl")) {
-        ExportMeshAsStlTo(f, m);
+        mfw.WriteStl(m);
     } else if(FilenameHasExtension(filename, ".obj")) {
-        ExportMeshAsObjTo(f, m);
+        mfw.WriteObj(m);
     } else if(FilenameHasExtension(filename, ".js") ||
               FilenameHasExtension(filename, ".html")) {
         SEdgeList *e = &(SK.GetGroup(SS.GW.activeGroup)->displayEdges);
@@ -764,82 +773,12 @@ void SolveSpaceUI::ExportMeshTo(const std::string &filename) {
     InvalidateGraphics();
 }
 
-//-----------------------------------------------------------------------------
-// Export the mesh as an STL file; it should always be vertex-to-vertex and
-// not self-intersecting, so not much to do.
-//-----------------------------------------------------------------------------
-void SolveSpaceUI::ExportMeshAsStlTo(FILE *f, SMesh *sm) {
-    char str[80] = {};
-    strcpy(str, "STL exported mesh");
-    fwrite(str, 1, 80, f);
-
-    uint32_t n = sm->l.n;
-    fwrite(&n, 4, 1, f);
-
-    double s = SS.exportScale;
-    int i;
-    for(i = 0; i < sm->l.n; i++) {
-        STriangle *tr = &(sm->l.elem[i]);
-        Vector n = tr->Normal().WithMagnitude(1);
-        float w;
-        w = (float)n.x;           fwrite(&w, 4, 1, f);
-        w = (float)n.y;           fwrite(&w, 4, 1, f);
-        w = (float)n.z;           fwrite(&w, 4, 1, f);
-        w = (float)((tr->a.x)/s); fwrite(&w, 4, 1, f);
-        w = (float)((tr->a.y)/s); fwrite(&w, 4, 1, f);
-        w = (float)((tr->a.z)/s); fwrite(&w, 4, 1, f);
-        w = (float)((tr->b.x)/s); fwrite(&w, 4, 1, f);
-        w = (float)((tr->b.y)/s); fwrite(&w, 4, 1, f);
-        w = (float)((tr->b.z)/s); fwrite(&w, 4, 1, f);
-        w = (float)((tr->c.x)/s); fwrite(&w, 4, 1, f);
-        w = (float)((tr->c.y)/s); fwrite(&w, 4, 1, f);
-        w = (float)((tr->c.z)/s); fwrite(&w, 4, 1, f);
-        fputc(0, f);
-        fputc(0, f);
-    }
-}
-
-//-----------------------------------------------------------------------------
-// Export the mesh as Wavefront OBJ format. This requires us to reduce all the
-// identical vertices to the same identifier, so do that first.
-//-----------------------------------------------------------------------------
-void SolveSpaceUI::ExportMeshAsObjTo(FILE *f, SMesh *sm) {
-    SPointList spl = {};
-    STriangle *tr;
-    for(tr = sm->l.First(); tr; tr = sm->l.NextAfter(tr)) {
-        spl.IncrementTagFor(tr->a);
-        spl.IncrementTagFor(tr->b);
-        spl.IncrementTagFor(tr->c);
-    }
-
-    // Output all the vertices.
-    SPoint *sp;
-    for(sp = spl.l.First(); sp; sp = spl.l.NextAfter(sp)) {
-        fprintf(f, "v %.10f %.10f %.10f\r\n",
-                        sp->p.x / SS.exportScale,
-                        sp->p.y / SS.exportScale,
-                        sp->p.z / SS.exportScale);
-    }
-
-    // And now all the triangular faces, in terms of those vertices. The
-    // file format counts from 1, not 0.
-    for(tr = sm->l.First(); tr; tr = sm->l.NextAfter(tr)) {
-        fprintf(f, "f %d %d %d\r\n",
-                        spl.IndexForPoint(tr->a) + 1,
-                        spl.IndexForPoint(tr->b) + 1,
-                        spl.IndexForPoint(tr->c) + 1);
-    }
-
-    spl.Clear();
-}
-
 //-----------------------------------------------------------------------------
 // Export the mesh as a JavaScript script, which is compatible with Three.js.
 //-----------------------------------------------------------------------------
 void SolveSpaceUI::ExportMeshAsThreeJsTo(FILE *f, const std::string &filename,
                                          SMesh *sm, SEdgeList *sel)
 {
-    SPointList spl = {};
     STriangle *tr;
     SEdge *e;
     Vector bndl, bndh;
@@ -1413,32 +1352,25 @@ SolvespaceCamera = function(renderWidth, renderHeight, scale, up, right, offset)
     fprintf(f, "    ],\n"
                "    a: %f\n", SS.ambientIntensity);
 
-    for(tr = sm->l.First(); tr; tr = sm->l.NextAfter(tr)) {
-        spl.IncrementTagFor(tr->a);
-        spl.IncrementTagFor(tr->b);
-        spl.IncrementTagFor(tr->c);
-    }
+    SIndexedMesh im = {};
+    im.MakeFromMesh(sm, /*withNormals=*/false);
 
     // Output all the vertices.
-    SPoint *sp;
     fputs("  },\n"
           "  points: [\n", f);
-    for(sp = spl.l.First(); sp; sp = spl.l.NextAfter(sp)) {
+    for(Vector &p : im.vertex) {
         fprintf(f, "    [%f, %f, %f],\n",
-                sp->p.x / SS.exportScale,
-                sp->p.y / SS.exportScale,
-                sp->p.z / SS.exportScale);
+                p.x / SS.exportScale,
+                p.y / SS.exportScale,
+                p.z / SS.exportScale);
     }
 
     fputs("  ],\n"
           "  faces: [\n", f);
     // And now all the triangular faces, in terms of those vertices.
     // This time we count from zero.
-    for(tr = sm->l.First(); tr; tr = sm->l.NextAfter(tr)) {
-        fprintf(f, "    [%d, %d, %d],\n",
-                spl.IndexForPoint(tr->a),
-                spl.IndexForPoint(tr->b),
-                spl.IndexForPoint(tr->c));
+    for(SIndexedMesh::Triangle &t : im.tri) {
+        fprintf(f, "    [%d, %d, %d],\n", t.v[0], t.v[1], t.v[2]);
     }
 
     // Output face normals.
@@ -1474,7 +1406,7 @@ SolvespaceCamera = function(renderWidth, renderHeight, scale, up, right, offset)
     if(extension == "html")
         fprintf(f, htmlend, baseFilename.c_str());
 
-    spl.Clear();
+    im.Clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -0,0 +1,107 @@
+//-----------------------------------------------------------------------------
+// Export a triangle mesh as STL or Wavefront OBJ, streamed out through a
+// buffer, for meshes with millions of triangles.
+//-----------------------------------------------------------------------------
+#include "solvespace.h"
+
+void MeshFileWriter::Write(const void *data, size_t len) {
+    if(buf.size() + len > BUFFER_SIZE) Flush();
+    const char *p = (const char *)data;
+    buf.insert(buf.end(), p, p + len);
+}
+
+void MeshFileWriter::Printf(const char *fmt, ...) {
+    char line[256];
+    va_list va;
+    va_start(va, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, va);
+    va_end(va);
+
+    if(n >= 0 && n < (int)sizeof(line)) {
+        Write(line, n);
+    } else {
+        // Some enormous coordinate, so fall back to the slow way.
+        va_start(va, fmt);
+        std::vector<char> big(std::max(n, 0) + 1);
+        vsnprintf(&big[0], big.size(), fmt, va);
+        va_end(va);
+        Write(&big[0], big.size() - 1);
+    }
+}
+
+void MeshFileWriter::Flush(void) {
+    if(!buf.empty()) fwrite(&buf[0], 1, buf.size(), f);
+    buf.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Export the mesh as a binary STL file; it should always be vertex-to-vertex
+// and not self-intersecting, so not much to do. Each triangle is a packed
+// 50 byte record: the normal and three vertices as little-endian floats, and
+// then two bytes of attributes that we leave zero.
+//-----------------------------------------------------------------------------
+static void PutFloat(uint8_t *dest, double v) {
+    float w = (float)v;
+    uint32_t u;
+    memcpy(&u, &w, 4);
+    dest[0] = (uint8_t)(u);
+    dest[1] = (uint8_t)(u >> 8);
+    dest[2] = (uint8_t)(u >> 16);
+    dest[3] = (uint8_t)(u >> 24);
+}
+
+void MeshFileWriter::WriteStl(SMesh *sm) {
+    uint8_t header[84] = {};
+    strcpy((char *)header, "STL exported mesh");
+    uint32_t n = sm->l.n;
+    header[80] = (uint8_t)(n);
+    header[81] = (uint8_t)(n >> 8);
+    header[82] = (uint8_t)(n >> 16);
+    header[83] = (uint8_t)(n >> 24);
+    Write(header, sizeof(header));
+
+    int i;
+    for(i = 0; i < sm->l.n; i++) {
+        STriangle *tr = &(sm->l.elem[i]);
+        Vector n = tr->Normal().WithMagnitude(1);
+
+        uint8_t rec[50] = {};
+        PutFloat(&rec[ 0], n.x);
+        PutFloat(&rec[ 4], n.y);
+        PutFloat(&rec[ 8], n.z);
+        PutFloat(&rec[12], tr->a.x/scale);
+        PutFloat(&rec[16], tr->a.y/scale);
+        PutFloat(&rec[20], tr->a.z/scale);
+        PutFloat(&rec[24], tr->b.x/scale);
+        PutFloat(&rec[28], tr->b.y/scale);
+        PutFloat(&rec[32], tr->b.z/scale);
+        PutFloat(&rec[36], tr->c.x/scale);
+        PutFloat(&rec[40], tr->c.y/scale);
+        PutFloat(&rec[44], tr->c.z/scale);
+        Write(rec, sizeof(rec));
+    }
+    Flush();
+}
+
+//-----------------------------------------------------------------------------
+// Export the mesh as Wavefront OBJ format. This requires us to reduce all the
+// identical vertices to the same identifier, so do that first.
+//-----------------------------------------------------------------------------
+void MeshFileWriter::WriteObj(SMesh *sm) {
+    SIndexedMesh im = {};
+    im.MakeFromMesh(sm, /*withNormals=*/false);
+
+    // Output all the vertices.
+    for(Vector &p : im.vertex) {
+        Printf("v %.10f %.10f %.10f\r\n", p.x/scale, p.y/scale, p.z/scale);
+    }
+
+    // And now all the triangular faces, in terms of those vertices. The
+    // file format counts from 1, not 0.
+    for(SIndexedMesh::Triangle &t : im.tri) {
+        Printf("f %d %d %d\r\n", t.v[0] + 1, t.v[1] + 1, t.v[2] + 1);
+    }
+    Flush();
+
+    im.Clear();
+}
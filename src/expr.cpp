@@ -411,6 +411,15 @@ uint64_t Expr::ParamsUsed(void) {
     return r;
 }
 
+void Expr::ParamsUsedList(std::vector<hParam> *list) {
+    if(op == PARAM)     list->push_back(parh);
+    if(op == PARAM_PTR) list->push_back(parp->h);
+
+    int c = Children();
+    if(c >= 1)          a->ParamsUsedList(list);
+    if(c >= 2)          b->ParamsUsedList(list);
+}
+
 bool Expr::DependsOn(hParam p) {
     if(op == PARAM)     return (parh.v    == p.v);
     if(op == PARAM_PTR) return (parp->h.v == p.v);
@@ -503,6 +512,246 @@ void Expr::Substitute(hParam oldh, hParam newh) {
     if(c >= 2) b->Substitute(oldh, newh);
 }
 
+size_t ExprTape::KeyHash::operator()(const Key &k) const {
+    size_t h = (size_t)k.bits;
+    h = h*31 + (size_t)k.op;
+    h = h*31 + (size_t)k.a;
+    h = h*31 + (size_t)k.b;
+    return h ^ (h >> 17);
+}
+
+void ExprTape::Clear(void) {
+    code.clear();
+    slot.clear();
+    outSlot.clear();
+    outStart.clear();
+    outCode.clear();
+    adj.clear();
+    DoneAdding();
+}
+
+//-----------------------------------------------------------------------------
+// Compile an expression on to the end of the tape, and return the slot that
+// will hold its value. Constants are written in to their slots now, and
+// never need to be evaluated again.
+//-----------------------------------------------------------------------------
+int ExprTape::Add(Expr *e) {
+    auto it = done.find(e);
+    if(it != done.end()) return it->second;
+
+    Key k = {};
+    k.op = e->op;
+    k.a = -1;
+    k.b = -1;
+    switch(e->op) {
+        case Expr::CONSTANT:    memcpy(&k.bits, &(e->v), sizeof(double)); break;
+        case Expr::PARAM_PTR:   k.bits = (uint64_t)(uintptr_t)e->parp; break;
+
+        case Expr::PLUS:
+        case Expr::TIMES:
+            k.a = Add(e->a);
+            k.b = Add(e->b);
+            // These commute, and do so exactly in floating point.
+            if(k.a > k.b) std::swap(k.a, k.b);
+            break;
+
+        case Expr::MINUS:
+        case Expr::DIV:
+            k.a = Add(e->a);
+            k.b = Add(e->b);
+            break;
+
+        case Expr::NEGATE:
+        case Expr::SQRT:
+        case Expr::SQUARE:
+        case Expr::SIN:
+        case Expr::COS:
+        case Expr::ASIN:
+        case Expr::ACOS:
+            k.a = Add(e->a);
+            break;
+
+        default: oops();
+    }
+
+    int r;
+    auto ut = unique.find(k);
+    if(ut != unique.end()) {
+        r = ut->second;
+    } else {
+        r = (int)slot.size();
+        if(e->op == Expr::CONSTANT) {
+            slot.push_back(e->v);
+            codeOf.push_back(-1);
+        } else {
+            slot.push_back(0);
+            codeOf.push_back((int)code.size());
+            Instr in = { e->op, r, k.a, k.b, NULL, {} };
+            if(e->op == Expr::PARAM_PTR) {
+                in.parp = e->parp;
+                in.parh = e->parp->h;
+            }
+            code.push_back(in);
+        }
+        seen.push_back(-1);
+        unique[k] = r;
+    }
+    done[e] = r;
+    return r;
+}
+
+//-----------------------------------------------------------------------------
+// Compile an expression as an output, and note which instructions it depends
+// on, for Reverse(). Returns the number of the output.
+//-----------------------------------------------------------------------------
+int ExprTape::AddOutput(Expr *e) {
+    int out = (int)outSlot.size();
+    int r = Add(e);
+    outSlot.push_back(r);
+    if(outStart.empty()) outStart.push_back(0);
+
+    size_t first = outCode.size();
+    std::vector<int> stack;
+    stack.push_back(r);
+    seen[r] = out;
+    while(!stack.empty()) {
+        int c = codeOf[stack.back()];
+        stack.pop_back();
+        if(c < 0) continue;
+        outCode.push_back(c);
+
+        const Instr &in = code[c];
+        if(in.a >= 0 && seen[in.a] != out) {
+            seen[in.a] = out;
+            stack.push_back(in.a);
+        }
+        if(in.b >= 0 && seen[in.b] != out) {
+            seen[in.b] = out;
+            stack.push_back(in.b);
+        }
+    }
+    // The tape is already in dependency order, so this gets them in to
+    // the order that we must evaluate them.
+    std::sort(outCode.begin() + first, outCode.end());
+    outStart.push_back((int)outCode.size());
+    return out;
+}
+
+int ExprTape::SlotOfParam(Param *p) {
+    Key k = {};
+    k.op = Expr::PARAM_PTR;
+    k.a = -1;
+    k.b = -1;
+    k.bits = (uint64_t)(uintptr_t)p;
+    auto it = unique.find(k);
+    return (it == unique.end()) ? -1 : it->second;
+}
+
+void ExprTape::DoneAdding(void) {
+    done.clear();
+    unique.clear();
+    codeOf.clear();
+    seen.clear();
+    adj.assign(slot.size(), 0.0);
+}
+
+//-----------------------------------------------------------------------------
+// Point the tape at the params in a table that was written again since it
+// was compiled, looking them up by handle as DeepCopyWithParamsAsPointers()
+// did the first time.
+//-----------------------------------------------------------------------------
+void ExprTape::Rebind(IdList<Param,hParam> *firstTry,
+                      IdList<Param,hParam> *thenTry)
+{
+    for(Instr &in : code) {
+        if(in.op != Expr::PARAM_PTR) continue;
+        Param *p = firstTry->FindByIdNoOops(in.parh);
+        if(!p) p = thenTry->FindById(in.parh);
+        in.parp = p;
+    }
+}
+
+void ExprTape::Run(void) {
+    double *s = slot.data();
+    const Instr *in = code.data();
+    const Instr *last = in + code.size();
+    for(; in < last; in++) {
+        switch(in->op) {
+            case Expr::PARAM_PTR:   s[in->dest] = in->parp->val; break;
+
+            case Expr::PLUS:        s[in->dest] = s[in->a] + s[in->b]; break;
+            case Expr::MINUS:       s[in->dest] = s[in->a] - s[in->b]; break;
+            case Expr::TIMES:       s[in->dest] = s[in->a] * s[in->b]; break;
+            case Expr::DIV:         s[in->dest] = s[in->a] / s[in->b]; break;
+
+            case Expr::NEGATE:      s[in->dest] = -s[in->a]; break;
+            case Expr::SQRT:        s[in->dest] = sqrt(s[in->a]); break;
+            case Expr::SQUARE:      s[in->dest] = s[in->a]*s[in->a]; break;
+            case Expr::SIN:         s[in->dest] = sin(s[in->a]); break;
+            case Expr::COS:         s[in->dest] = cos(s[in->a]); break;
+            case Expr::ACOS:        s[in->dest] = acos(s[in->a]); break;
+            case Expr::ASIN:        s[in->dest] = asin(s[in->a]); break;
+
+            default: oops();
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// After a Run(), sweep backwards through the instructions for the given
+// output, applying the chain rule; that leaves the partial of the output
+// with respect to each of its params in adj[], at the param's slot.
+//-----------------------------------------------------------------------------
+void ExprTape::Reverse(int out) {
+    const double *s = slot.data();
+    double *d = adj.data();
+    const int *first = outCode.data() + outStart[out],
+              *last  = outCode.data() + outStart[out+1];
+    const int *c;
+
+    for(c = first; c < last; c++) {
+        d[code[*c].dest] = 0;
+    }
+    d[outSlot[out]] = 1;
+
+    for(c = last - 1; c >= first; c--) {
+        const Instr &in = code[*c];
+        double g = d[in.dest];
+        if(g == 0) continue;
+        switch(in.op) {
+            case Expr::PARAM_PTR:
+                break;
+
+            case Expr::PLUS:
+                d[in.a] += g;
+                d[in.b] += g;
+                break;
+            case Expr::MINUS:
+                d[in.a] += g;
+                d[in.b] -= g;
+                break;
+            case Expr::TIMES:
+                d[in.a] += g*s[in.b];
+                d[in.b] += g*s[in.a];
+                break;
+            case Expr::DIV:
+                d[in.a] += g/s[in.b];
+                d[in.b] -= g*s[in.a]/(s[in.b]*s[in.b]);
+                break;
+
+            case Expr::NEGATE:  d[in.a] -= g; break;
+            case Expr::SQRT:    d[in.a] += g*0.5/s[in.dest]; break;
+            case Expr::SQUARE:  d[in.a] += g*2*s[in.a]; break;
+            case Expr::SIN:     d[in.a] += g*cos(s[in.a]); break;
+            case Expr::COS:     d[in.a] -= g*sin(s[in.a]); break;
+            case Expr::ASIN:    d[in.a] += g/sqrt(1 - s[in.a]*s[in.a]); break;
+            case Expr::ACOS:    d[in.a] -= g/sqrt(1 - s[in.a]*s[in.a]); break;
+
+            default: oops();
+        }
+    }
+}
+
 //-----------------------------------------------------------------------------
 // If the expression references only one parameter that appears in pl, then
 // return that parameter. If no param is referenced, then return NO_PARAMS.
@@ -83,6 +83,7 @@ public:
     Expr *PartialWrt(hParam p);
     double Eval(void);
     uint64_t ParamsUsed(void);
+    void ParamsUsedList(std::vector<hParam> *list);
     bool DependsOn(hParam p);
     static bool Tol(double a, double b);
     Expr *FoldConstants(void);
@@ -127,6 +128,66 @@ public:
     static void Parse(void);
 };
 
+// A set of expressions, compiled to a flat list of instructions that can be
+// evaluated much faster than by walking the trees. Each distinct
+// subexpression gets a slot that's computed once per evaluation; that's by
+// structure, not by pointer, so repeated pieces are all shared. Only
+// constants and params by pointer may appear in the leaves.
+//
+// The outputs can also be differentiated in reverse mode: one backward
+// sweep over the instructions that an output depends on gives its partial
+// with respect to every param at once, without ever writing the derivatives
+// out symbolically.
+class ExprTape {
+public:
+    struct Instr {
+        int     op;
+        int     dest;
+        int     a, b;
+        Param  *parp;
+        hParam  parh;
+    };
+    struct Key {
+        int         op;
+        int         a, b;
+        uint64_t    bits;
+
+        bool operator==(const Key &k) const
+            { return op == k.op && a == k.a && b == k.b && bits == k.bits; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key &k) const;
+    };
+
+    std::vector<Instr>  code;
+    std::vector<double> slot;
+
+    // The slot for each output, and the instructions that it depends on,
+    // in order; those for output i are at [outStart[i], outStart[i+1]).
+    std::vector<int>    outSlot;
+    std::vector<int>    outStart;
+    std::vector<int>    outCode;
+    // The partials from the last Reverse(), by slot
+    std::vector<double> adj;
+
+    // Only needed while we're adding expressions
+    std::unordered_map<Expr *, int>         done;
+    std::unordered_map<Key, int, KeyHash>   unique;
+    std::vector<int>                        codeOf;
+    std::vector<int>                        seen;
+
+    void Clear(void);
+    int Add(Expr *e);
+    int AddOutput(Expr *e);
+    int SlotOfParam(Param *p);
+    void DoneAdding(void);
+    void Rebind(IdList<Param,hParam> *firstTry,
+                IdList<Param,hParam> *thenTry);
+
+    void Run(void);
+    void Reverse(int out);
+};
+
 class ExprVector {
 public:
     Expr *x, *y, *z;
@@ -143,6 +143,10 @@ bool SolveSpaceUI::PruneConstraints(hGroup hg) {
 
 void SolveSpaceUI::GenerateAll(GenerateType type, bool andFindFree, bool genForBBox) {
     int first, last, i, j;
+    TemporaryStats before;
+    GetTemporaryStats(&before);
+    regenBoolean = {};
+    regenMs = {};
 
     SK.groupOrder.Clear();
     for(int i = 0; i < SK.group.n; i++)
@@ -232,10 +236,12 @@ void SolveSpaceUI::GenerateAll(GenerateType type, bool andFindFree, bool genForB
         int64_t now = GetMilliseconds();
         // Display the status message if we've taken more than 400 ms, or
         // if we've taken 200 ms but we're not even halfway done, or if
-        // we've already started displaying the status message.
-        if( (now - inTime > 400) ||
-           ((now - inTime > 200) && i < (SK.groupOrder.n / 2)) ||
-           displayedStatusMessage)
+        // we've already started displaying the status message; unless
+        // we're running headless, with no window to display it in.
+        if(!headless &&
+           ((now - inTime > 400) ||
+            ((now - inTime > 200) && i < (SK.groupOrder.n / 2)) ||
+            displayedStatusMessage))
         {
             displayedStatusMessage = true;
             std::string msg = ssprintf("generating group %d/%d", i, SK.groupOrder.n);
@@ -305,7 +311,9 @@ void SolveSpaceUI::GenerateAll(GenerateType type, bool andFindFree, bool genForB
                 // The group falls inside the range, so really solve it,
                 // and then regenerate the mesh based on the solved stuff.
                 if(genForBBox) {
+                    int64_t solveTime = GetMilliseconds();
                     SolveGroup(g->h, andFindFree);
+                    regenMs.solve += GetMilliseconds() - solveTime;
                 } else {
                     g->GenerateLoops();
                     g->GenerateShellAndMesh();
@@ -387,6 +395,11 @@ void SolveSpaceUI::GenerateAll(GenerateType type, bool andFindFree, bool genForB
         deleted = {};
     }
 
+    // Note how much temporary memory that took, before we free it.
+    GetTemporaryStats(&regenTemporary);
+    regenTemporary.allocs -= before.allocs;
+    regenTemporary.bytes  -= before.bytes;
+
     FreeAllTemporary();
     allConsistent = true;
     return;
@@ -512,6 +525,7 @@ void SolveSpaceUI::SolveGroup(hGroup hg, bool andFindFree) {
     }
 
     MarkDraggedParams();
+    sys.workerThreads = GetWorkerThreads();
     g->solved.remove.Clear();
     int how = sys.Solve(g, &(g->solved.dof),
                            &(g->solved.remove), true, andFindFree);
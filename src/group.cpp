@@ -27,6 +27,8 @@ void Group::Clear(void) {
     runningMesh.Clear();
     thisShell.Clear();
     runningShell.Clear();
+    thisHash = 0;
+    runningHash = 0;
     displayMesh.Clear();
     displayEdges.Clear();
     displayOutlines.Clear();
@@ -104,12 +104,53 @@ void SMesh::RemapFaces(Group *g, int remap) {
     }
 }
 
+//-----------------------------------------------------------------------------
+// Combine the n shells or meshes in copies into out, taking ownership of
+// them. Unioning them in turn into an ever-growing result would be quadratic
+// in n, so union them by halves instead. And if the two halves' bounding
+// boxes don't overlap, then they can't intersect, so just assemble them;
+// that's the usual case for a pattern of holes or bolts.
+//-----------------------------------------------------------------------------
+// If a union anywhere down the tree failed, then so did the whole thing; but
+// only shells keep track of that.
+static void CarryBooleanFailed(SShell *out, SShell *a, SShell *b) {
+    out->booleanFailed = out->booleanFailed ||
+                         a->booleanFailed || b->booleanFailed;
+}
+static void CarryBooleanFailed(SMesh *out, SMesh *a, SMesh *b) {}
+
+template<class T>
+static void MakeFromUnionOfCopies(T *out, T *copies, int n) {
+    if(n == 1) {
+        *out = copies[0];
+        copies[0] = {};
+        return;
+    }
+
+    T a = {}, b = {};
+    MakeFromUnionOfCopies(&a, copies, n/2);
+    MakeFromUnionOfCopies(&b, copies + n/2, n - n/2);
+
+    Vector amax, amin, bmax, bmin;
+    a.GetBounding(&amax, &amin);
+    b.GetBounding(&bmax, &bmin);
+    if(a.IsEmpty()) {
+        out->MakeFromCopyOf(&b);
+    } else if(b.IsEmpty()) {
+        out->MakeFromCopyOf(&a);
+    } else if(Vector::BoundingBoxesDisjoint(amax, amin, bmax, bmin)) {
+        out->MakeFromAssemblyOf(&a, &b);
+    } else {
+        out->MakeFromUnionOf(&a, &b);
+    }
+    CarryBooleanFailed(out, &a, &b);
+    a.Clear();
+    b.Clear();
+}
+
 template<class T>
 void Group::GenerateForStepAndRepeat(T *steps, T *outs) {
-    T workA, workB;
-    workA = {};
-    workB = {};
-    T *soFar = &workA, *scratch = &workB;
+    std::vector<T> copies;
 
     int n = (int)valA, a0 = 0;
     if(subtype == ONE_SIDED && skipFirst) {
@@ -140,20 +181,13 @@ void Group::GenerateForStepAndRepeat(T *steps, T *outs) {
         // We need to rewrite any plane face entities to the transformed ones.
         transd.RemapFaces(this, remap);
 
-        // And tack this transformed copy on to the return.
-        if(soFar->IsEmpty()) {
-            scratch->MakeFromCopyOf(&transd);
-        } else {
-            scratch->MakeFromUnionOf(soFar, &transd);
-        }
-
-        swap(scratch, soFar);
-        scratch->Clear();
-        transd.Clear();
+        copies.push_back(transd);
     }
 
+    // And combine all the transformed copies to make the return.
     outs->Clear();
-    *outs = *soFar;
+    if(copies.empty()) return;
+    MakeFromUnionOfCopies(outs, &copies[0], (int)copies.size());
 }
 
 template<class T>
@@ -177,12 +211,176 @@ void Group::GenerateForBoolean(T *prevs, T *thiss, T *outs, int how) {
     }
 }
 
+//-----------------------------------------------------------------------------
+// Helpers to fingerprint the geometry that goes into a group's shell or mesh.
+//-----------------------------------------------------------------------------
+static uint64_t HashVector(uint64_t h, Vector v) {
+    h = HashDouble(h, v.x);
+    h = HashDouble(h, v.y);
+    return HashDouble(h, v.z);
+}
+
+static uint64_t HashBezier(uint64_t h, SBezier *sb) {
+    h = HashMix(h, sb->deg);
+    h = HashMix(h, sb->entity);
+    int i;
+    for(i = 0; i <= sb->deg; i++) {
+        h = HashVector(h, sb->ctrl[i]);
+        h = HashDouble(h, sb->weight[i]);
+    }
+    return h;
+}
+
+static uint64_t HashBezierLoops(uint64_t h, SBezierLoopSetSet *sblss) {
+    SBezierLoopSet *sbls;
+    for(sbls = sblss->l.First(); sbls; sbls = sblss->l.NextAfter(sbls)) {
+        h = HashVector(h, sbls->normal);
+        h = HashVector(h, sbls->point);
+        h = HashMix(h, sbls->l.n);
+        SBezierLoop *sbl;
+        for(sbl = sbls->l.First(); sbl; sbl = sbls->l.NextAfter(sbl)) {
+            h = HashMix(h, sbl->l.n);
+            SBezier *sb;
+            for(sb = sbl->l.First(); sb; sb = sbl->l.NextAfter(sb)) {
+                h = HashBezier(h, sb);
+            }
+        }
+    }
+    return h;
+}
+
+static uint64_t HashShell(uint64_t h, SShell *s) {
+    SCurve *sc;
+    for(sc = s->curve.First(); sc; sc = s->curve.NextAfter(sc)) {
+        h = HashMix(h, sc->h.v);
+        h = HashMix(h, sc->source);
+        h = HashMix(h, sc->isExact);
+        if(sc->isExact) h = HashBezier(h, &(sc->exact));
+        SCurvePt *scpt;
+        for(scpt = sc->pts.First(); scpt; scpt = sc->pts.NextAfter(scpt)) {
+            h = HashVector(h, scpt->p);
+            h = HashMix(h, scpt->vertex);
+        }
+        h = HashMix(h, sc->surfA.v);
+        h = HashMix(h, sc->surfB.v);
+    }
+    SSurface *ss;
+    for(ss = s->surface.First(); ss; ss = s->surface.NextAfter(ss)) {
+        h = HashMix(h, ss->h.v);
+        h = HashMix(h, ss->face);
+        h = HashMix(h, ss->color.ToPackedInt());
+        h = HashMix(h, ss->degm);
+        h = HashMix(h, ss->degn);
+        int i, j;
+        for(i = 0; i <= ss->degm; i++) {
+            for(j = 0; j <= ss->degn; j++) {
+                h = HashVector(h, ss->ctrl[i][j]);
+                h = HashDouble(h, ss->weight[i][j]);
+            }
+        }
+        STrimBy *stb;
+        for(stb = ss->trim.First(); stb; stb = ss->trim.NextAfter(stb)) {
+            h = HashMix(h, stb->curve.v);
+            h = HashMix(h, stb->backwards);
+            h = HashVector(h, stb->start);
+            h = HashVector(h, stb->finish);
+        }
+    }
+    return h;
+}
+
+static uint64_t HashMesh(uint64_t h, SMesh *m) {
+    STriangle *tr;
+    for(tr = m->l.First(); tr; tr = m->l.NextAfter(tr)) {
+        h = HashMix(h, tr->meta.face);
+        h = HashMix(h, tr->meta.color.ToPackedInt());
+        h = HashVector(h, tr->a);
+        h = HashVector(h, tr->b);
+        h = HashVector(h, tr->c);
+    }
+    return h;
+}
+
+//-----------------------------------------------------------------------------
+// A fingerprint of everything that goes into this group's own shell and
+// mesh: its settings and solved parameters, and the section that it extrudes
+// or lathes, or the shell that it steps and repeats, or the linked part. If
+// this is unchanged, then so are thisShell and thisMesh.
+//-----------------------------------------------------------------------------
+uint64_t Group::HashShellInputs(void) {
+    Group *srcg = this;
+    if(type == TRANSLATE || type == ROTATE) srcg = SK.GetGroup(opA);
+
+    uint64_t hash = HashMix(0, type);
+    hash = HashMix(hash, subtype);
+    hash = HashMix(hash, color.ToPackedInt());
+    hash = HashMix(hash, srcg->meshCombine);
+    hash = HashMix(hash, skipFirst);
+    hash = HashDouble(hash, valA);
+    hash = HashDouble(hash, scale);
+    // The Booleans and the merging of coplanar faces depend on these too.
+    hash = HashDouble(hash, SS.ChordTolMm());
+    hash = HashMix(hash, SS.maxSegments);
+    // And the triangle mesh on the choice of triangulator.
+    hash = HashMix(hash, SS.monotoneTriangulation);
+
+    int i;
+    for(i = 0; i < 7; i++) {
+        Param *p = SK.param.FindByIdNoOops(h.param(i));
+        if(p) hash = HashDouble(hash, p->val);
+    }
+
+    if(type == TRANSLATE || type == ROTATE) {
+        hash = HashMix(hash, srcg->thisHash);
+    } else if(type == EXTRUDE || type == LATHE) {
+        Group *src = SK.GetGroup(opA);
+        hash = HashMix(hash, src->polyError.how);
+        hash = HashBezierLoops(hash, &(src->bezierLoops));
+        if(type == EXTRUDE) {
+            // The side faces get named for the line segments they came from.
+            Entity *e;
+            for(e = SK.entity.First(); e; e = SK.entity.NextAfter(e)) {
+                if(e->group.v != opA.v) continue;
+                if(e->type != Entity::LINE_SEGMENT) continue;
+
+                hash = HashMix(hash, e->h.v);
+                hash = HashVector(hash, SK.GetEntity(e->point[0])->PointGetNum());
+                hash = HashVector(hash, SK.GetEntity(e->point[1])->PointGetNum());
+            }
+        } else {
+            hash = HashVector(hash, SK.GetEntity(predef.origin)->PointGetNum());
+            hash = HashVector(hash, SK.GetEntity(predef.entityB)->VectorGetNum());
+        }
+    } else if(type == LINKED) {
+        hash = HashShell(hash, &impShell);
+        hash = HashMesh(hash, &impMesh);
+    }
+    return hash;
+}
+
 void Group::GenerateShellAndMesh(void) {
+    // A step and repeat gets merged against the group's prevous group,
+    // not our own previous group.
+    Group *srcg = this;
+    if(type == TRANSLATE || type == ROTATE) srcg = SK.GetGroup(opA);
+    Group *prevg = srcg->RunningMeshGroup();
+
+    // If nothing that goes into our shell and mesh has changed, and the
+    // previous group's running shell and mesh haven't either, then the
+    // Boolean would just give us what we've already got.
+    uint64_t newThisHash = HashShellInputs();
+    uint64_t newRunningHash = HashMix(newThisHash, prevg->runningHash);
+    newRunningHash = HashMix(newRunningHash, forceToMesh);
+    newRunningHash = HashMix(newRunningHash, suppress);
+    if(thisHash != 0 && thisHash == newThisHash &&
+       runningHash == newRunningHash)
+    {
+        return;
+    }
+
     bool prevBooleanFailed = booleanFailed;
     booleanFailed = false;
 
-    Group *srcg = this;
-
     thisShell.Clear();
     thisMesh.Clear();
     runningShell.Clear();
@@ -199,12 +397,10 @@ void Group::GenerateShellAndMesh(void) {
     }
 
     if(type == TRANSLATE || type == ROTATE) {
-        // A step and repeat gets merged against the group's prevous group,
-        // not our own previous group.
-        srcg = SK.GetGroup(opA);
-
+        int64_t booleanTime = GetMilliseconds();
         GenerateForStepAndRepeat<SShell>(&(srcg->thisShell), &thisShell);
         GenerateForStepAndRepeat<SMesh> (&(srcg->thisMesh),  &thisMesh);
+        SS.regenMs.boolean += GetMilliseconds() - booleanTime;
     } else if(type == EXTRUDE && haveSrc) {
         Group *src = SK.GetGroup(opA);
         Vector translate = Vector::From(h.param(0), h.param(1), h.param(2));
@@ -313,9 +509,8 @@ void Group::GenerateShellAndMesh(void) {
     // the previous group's mesh or shell with the requested Boolean, and
     // we're done.
 
-    Group *prevg = srcg->RunningMeshGroup();
-
     if(prevg->runningMesh.IsEmpty() && thisMesh.IsEmpty() && !forceToMesh) {
+        int64_t booleanTime = GetMilliseconds();
         SShell *prevs = &(prevg->runningShell);
         GenerateForBoolean<SShell>(prevs, &thisShell, &runningShell,
             srcg->meshCombine);
@@ -323,6 +518,7 @@ void Group::GenerateShellAndMesh(void) {
         if(srcg->meshCombine != COMBINE_AS_ASSEMBLE) {
             runningShell.MergeCoincidentSurfaces();
         }
+        SS.regenMs.boolean += GetMilliseconds() - booleanTime;
 
         // If the Boolean failed, then we should note that in the text screen
         // for this group.
@@ -341,6 +537,7 @@ void Group::GenerateShellAndMesh(void) {
         thism.MakeFromCopyOf(&thisMesh);
         thisShell.TriangulateInto(&thism);
 
+        int64_t booleanTime = GetMilliseconds();
         SMesh outm = {};
         GenerateForBoolean<SMesh>(&prevm, &thism, &outm, srcg->meshCombine);
 
@@ -348,12 +545,15 @@ void Group::GenerateShellAndMesh(void) {
         SKdNode *root = SKdNode::From(&outm);
         root->SnapToMesh(&outm);
         root->MakeMeshInto(&runningMesh);
+        SS.regenMs.boolean += GetMilliseconds() - booleanTime;
 
         outm.Clear();
         thism.Clear();
         prevm.Clear();
     }
 
+    thisHash = newThisHash;
+    runningHash = newRunningHash;
     displayDirty = true;
 }
 
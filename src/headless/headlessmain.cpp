@@ -0,0 +1,620 @@
+//-----------------------------------------------------------------------------
+// Our main() function for the command-line tool, which loads .slvs files,
+// regenerates them and exports them, without any windows; so the platform
+// interface here is mostly stubs, and the settings are the defaults, not
+// whatever the user last chose in the GUI.
+//-----------------------------------------------------------------------------
+#include <time.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <map>
+#include <iostream>
+
+#include <fontconfig/fontconfig.h>
+
+#include "solvespace.h"
+
+namespace SolveSpace {
+/* Settings */
+
+/* Kept for the life of the process only, so that every run exports with the
+   same tolerances; the ones that matter can be set on the command line. */
+static std::map<std::string, uint32_t>    cnfInt;
+static std::map<std::string, float>       cnfFloat;
+static std::map<std::string, std::string> cnfString;
+
+void CnfFreezeInt(uint32_t val, const std::string &key) {
+    cnfInt[key] = val;
+}
+
+uint32_t CnfThawInt(uint32_t val, const std::string &key) {
+    auto it = cnfInt.find(key);
+    return (it != cnfInt.end()) ? it->second : val;
+}
+
+void CnfFreezeFloat(float val, const std::string &key) {
+    cnfFloat[key] = val;
+}
+
+float CnfThawFloat(float val, const std::string &key) {
+    auto it = cnfFloat.find(key);
+    return (it != cnfFloat.end()) ? it->second : val;
+}
+
+void CnfFreezeString(const std::string &val, const std::string &key) {
+    cnfString[key] = val;
+}
+
+std::string CnfThawString(const std::string &val, const std::string &key) {
+    auto it = cnfString.find(key);
+    return (it != cnfString.end()) ? it->second : val;
+}
+
+/* Timers */
+
+int64_t GetMilliseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return 1000 * (uint64_t) ts.tv_sec + ts.tv_nsec / 1000000;
+}
+
+/* There's no message loop, so nothing later ever happens. */
+void SetTimerFor(int milliseconds) {}
+void SetAutosaveTimerFor(int minutes) {}
+void ScheduleLater() {}
+
+/* Windows, menus and controls; there are none. */
+
+void GetGraphicsWindowSize(int *w, int *h) { *w = *h = 0; }
+void GetTextWindowSize(int *w, int *h) { *w = *h = 0; }
+void InvalidateGraphics(void) {}
+void PaintGraphics(void) {}
+void InvalidateText(void) {}
+void ShowTextWindow(bool visible) {}
+void MoveTextScrollbarTo(int pos, int maxPos, int page) {}
+void SetCurrentFilename(const std::string &filename) {}
+void SetMousePointerToHand(bool is_hand) {}
+void ToggleFullScreen(void) {}
+bool FullScreenIsActive(void) { return false; }
+void ToggleMenuBar(void) {}
+bool MenuBarIsVisible(void) { return false; }
+
+void ShowGraphicsEditControl(int x, int y, int fontHeight, int minWidthChars,
+                             const std::string &val) {}
+void HideGraphicsEditControl(void) {}
+bool GraphicsEditControlIsVisible(void) { return false; }
+void ShowTextEditControl(int x, int y, const std::string &val) {}
+void HideTextEditControl(void) {}
+bool TextEditControlIsVisible(void) { return false; }
+
+void AddContextMenuItem(const char *label, int id) {}
+void CreateContextSubmenu(void) {}
+int ShowContextMenu(void) { return 0; }
+void EnableMenuById(int id, bool enabled) {}
+void CheckMenuById(int id, bool checked) {}
+void RadioMenuById(int id, bool selected) {}
+void RefreshRecentMenus(void) {}
+
+/* Dialogs; nobody is there to answer them, so take the choice that
+   changes nothing on disk, or gives up. */
+
+bool GetOpenFile(std::string *filename, const std::string &activeOrEmpty,
+                 const FileFilter filters[]) {
+    return false;
+}
+
+bool GetSaveFile(std::string *filename, const std::string &activeOrEmpty,
+                 const FileFilter filters[]) {
+    return false;
+}
+
+DialogChoice SaveFileYesNoCancel(void) {
+    return DIALOG_NO;
+}
+
+DialogChoice LoadAutosaveYesNo(void) {
+    return DIALOG_NO;
+}
+
+DialogChoice LocateImportedFileYesNoCancel(const std::string &filename,
+                                           bool canCancel) {
+    fprintf(stderr, "solvespace-cli: error: linked file '%s' is not present\n",
+            filename.c_str());
+    return canCancel ? DIALOG_CANCEL : DIALOG_NO;
+}
+
+/* Anything that would go in a message box goes to stderr instead, on one
+   line, with the file that it's about; and we note the errors, so that we
+   can fail that file. */
+static std::string currentInput;
+static bool errorReported;
+
+void DoMessageBox(const char *message, int rows, int cols, bool error) {
+    std::string line = message;
+    std::replace(line.begin(), line.end(), '\n', ' ');
+    fprintf(stderr, "solvespace-cli: %s: %s: %s\n", currentInput.c_str(),
+            error ? "error" : "message", line.c_str());
+    if(error) errorReported = true;
+}
+
+void OpenWebsite(const char *url) {}
+
+std::vector<std::string> GetFontFiles() {
+    std::vector<std::string> fonts;
+
+    /* Unlike in the GUI, nothing has initialized fontconfig for us, and
+       with no fonts configured at all that can fail. */
+    FcPattern   *pat = FcPatternCreate();
+    FcObjectSet *os  = FcObjectSetBuild(FC_FILE, (char *)0);
+    FcFontSet   *fs  = (pat && os) ? FcFontList(0, pat, os) : NULL;
+
+    if(fs) {
+        for(int i = 0; i < fs->nfont; i++) {
+            FcChar8 *filenameFC = FcPatternFormat(fs->fonts[i], (const FcChar8*) "%{file}");
+            if(!filenameFC) continue;
+            std::string filename = (char*) filenameFC;
+            fonts.push_back(filename);
+            FcStrFree(filenameFC);
+        }
+        FcFontSetDestroy(fs);
+    }
+    if(os)  FcObjectSetDestroy(os);
+    if(pat) FcPatternDestroy(pat);
+
+    return fonts;
+}
+
+void ExitNow(void) {}
+
+/* Command line */
+
+enum Command {
+    CMD_REGENERATE,
+    CMD_EXPORT_MESH,
+    CMD_EXPORT_SURFACES,
+    CMD_EXPORT_VIEW,
+    CMD_EXPORT_WIREFRAME,
+};
+
+static const struct {
+    const char *name;
+    Command     cmd;
+} Commands[] = {
+    { "regenerate",         CMD_REGENERATE       },
+    { "export-mesh",        CMD_EXPORT_MESH      },
+    { "export-surfaces",    CMD_EXPORT_SURFACES  },
+    { "export-view",        CMD_EXPORT_VIEW      },
+    { "export-wireframe",   CMD_EXPORT_WIREFRAME },
+};
+
+// The directions for export-view, as the screen's right and up vectors;
+// the view is along their cross product, into the screen.
+static const struct {
+    const char *name;
+    Vector      projRight;
+    Vector      projUp;
+} Views[] = {
+    { "front",      {  1, 0,  0 }, { 0, 1,  0 } },
+    { "back",       { -1, 0,  0 }, { 0, 1,  0 } },
+    { "top",        {  1, 0,  0 }, { 0, 0, -1 } },
+    { "bottom",     {  1, 0,  0 }, { 0, 0,  1 } },
+    { "right",      {  0, 0, -1 }, { 0, 1,  0 } },
+    { "left",       {  0, 0,  1 }, { 0, 1,  0 } },
+    { "isometric",  {  1, 0, -1 }, { -1, 2, -1 } },
+};
+
+struct Options {
+    Command     cmd;
+    std::string output;
+    int         view;
+    double      chordTol;
+    bool        timing;
+    int         jobs;
+};
+
+// How long we spent on each file, in milliseconds.
+struct Timing {
+    int64_t     load;
+    int64_t     solve;
+    int64_t     boolean;
+    int64_t     triangulate;
+    int64_t     write;
+};
+
+static void ShowUsage(void) {
+    fprintf(stderr,
+"Usage: solvespace-cli <command> [options] <file.slvs>...\n"
+"\n"
+"Commands:\n"
+"    regenerate\n"
+"        Loads and regenerates each file, without writing anything.\n"
+"    export-mesh --output <pattern>\n"
+"        Exports the active group's triangle mesh, as .stl, .obj, .js\n"
+"        or .html.\n"
+"    export-surfaces --output <pattern>\n"
+"        Exports the active group's surfaces, as .step or .stp.\n"
+"    export-view --output <pattern> [--view <direction>]\n"
+"        Exports a 2d view, as .pdf, .eps, .svg, .dxf, .plt or .ngc.\n"
+"        The direction is one of front (the default), back, top, bottom,\n"
+"        right, left or isometric.\n"
+"    export-wireframe --output <pattern>\n"
+"        Exports the 3d wireframe, as .dxf or .step.\n"
+"\n"
+"Options:\n"
+"    -o, --output <pattern>\n"
+"        The file to write; any %% is replaced by the input's name,\n"
+"        without its directory or extension.\n"
+"    --chord-tol <mm>\n"
+"        The chord tolerance for the export, in millimeters.\n"
+"    --timing\n"
+"        Prints how long each file took to load, solve, do the Booleans,\n"
+"        triangulate and write, in milliseconds, as tab-separated values\n"
+"        on stdout.\n"
+"    -j, --jobs <n>\n"
+"        Processes up to n files at once, each in a process of its own.\n"
+"\n"
+"Any input that's a directory stands for all the .slvs files in it.\n");
+}
+
+// A file is an input as it is; a directory gives the .slvs files in it, in
+// order of name, but not the ones in its subdirectories.
+static bool AddInputs(const std::string &path,
+                      std::vector<std::string> *inputs) {
+    struct stat st;
+    if(stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        inputs->push_back(path);
+        return true;
+    }
+
+    DIR *dir = opendir(path.c_str());
+    if(!dir) {
+        fprintf(stderr, "solvespace-cli: can't read directory '%s'\n",
+                path.c_str());
+        return false;
+    }
+    std::vector<std::string> names;
+    while(struct dirent *de = readdir(dir)) {
+        std::string name = de->d_name;
+        if(name.size() > 5 && name.compare(name.size() - 5, 5, ".slvs") == 0) {
+            names.push_back(name);
+        }
+    }
+    closedir(dir);
+
+    std::sort(names.begin(), names.end());
+    std::string prefix = path;
+    if(prefix.back() != PATH_SEP[0]) prefix += PATH_SEP;
+    for(const std::string &name : names) {
+        inputs->push_back(prefix + name);
+    }
+    return true;
+}
+
+static bool ParseArgs(int argc, char **argv, Options *opts,
+                      std::vector<std::string> *inputs) {
+    if(argc < 2) return false;
+
+    int i;
+    for(i = 0; i < (int)arraylen(Commands); i++) {
+        if(!strcmp(argv[1], Commands[i].name)) break;
+    }
+    if(i == (int)arraylen(Commands)) {
+        fprintf(stderr, "solvespace-cli: unknown command '%s'\n", argv[1]);
+        return false;
+    }
+    opts->cmd = Commands[i].cmd;
+
+    for(int arg = 2; arg < argc; arg++) {
+        std::string a = argv[arg];
+        bool hasValue = (arg + 1 < argc);
+        if((a == "-o" || a == "--output") && hasValue) {
+            opts->output = argv[++arg];
+        } else if(a == "--view" && hasValue) {
+            std::string name = argv[++arg];
+            for(i = 0; i < (int)arraylen(Views); i++) {
+                if(name == Views[i].name) break;
+            }
+            if(i == (int)arraylen(Views)) {
+                fprintf(stderr, "solvespace-cli: unknown view '%s'\n",
+                        name.c_str());
+                return false;
+            }
+            opts->view = i;
+        } else if(a == "--chord-tol" && hasValue) {
+            opts->chordTol = atof(argv[++arg]);
+            if(opts->chordTol <= 0) {
+                fprintf(stderr, "solvespace-cli: bad chord tolerance '%s'\n",
+                        argv[arg]);
+                return false;
+            }
+        } else if(a == "--timing") {
+            opts->timing = true;
+        } else if((a == "-j" || a == "--jobs") && hasValue) {
+            opts->jobs = atoi(argv[++arg]);
+            if(opts->jobs <= 0) {
+                fprintf(stderr, "solvespace-cli: bad number of jobs '%s'\n",
+                        argv[arg]);
+                return false;
+            }
+        } else if(a[0] == '-') {
+            fprintf(stderr, "solvespace-cli: bad option '%s'\n", a.c_str());
+            return false;
+        } else if(!AddInputs(a, inputs)) {
+            return false;
+        }
+    }
+
+    if(inputs->empty()) {
+        fprintf(stderr, "solvespace-cli: no input files\n");
+        return false;
+    }
+    if(opts->cmd != CMD_REGENERATE) {
+        if(opts->output.empty()) {
+            fprintf(stderr, "solvespace-cli: no --output given\n");
+            return false;
+        }
+        if(inputs->size() > 1 && opts->output.find('%') == std::string::npos) {
+            fprintf(stderr, "solvespace-cli: the --output must contain %% "
+                            "when exporting several files\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string OutputFor(const std::string &pattern,
+                             const std::string &input) {
+    size_t slash = input.find_last_of(PATH_SEP);
+    std::string name = input.substr(slash == std::string::npos ? 0 : slash + 1);
+    size_t dot = name.rfind('.');
+    if(dot != std::string::npos && dot > 0) name = name.substr(0, dot);
+
+    std::string out;
+    for(char c : pattern) {
+        if(c == '%') {
+            out += name;
+        } else {
+            out += c;
+        }
+    }
+    return out;
+}
+
+// Add whatever the regeneration since we last cleared the stats spent on
+// each phase, and return the total of those, so that the caller can leave
+// it out of its own phase.
+static int64_t TakeRegenTime(Timing *t) {
+    t->solve       += SS.regenMs.solve;
+    t->boolean     += SS.regenMs.boolean;
+    t->triangulate += SS.regenMs.triangulate;
+    int64_t total = SS.regenMs.solve + SS.regenMs.boolean +
+                    SS.regenMs.triangulate;
+    SS.regenMs = {};
+    return total;
+}
+
+static bool ProcessFile(const std::string &input, const Options &opts,
+                        Timing *t) {
+    currentInput  = input;
+    errorReported = false;
+    SS.regenMs = {};
+
+    int64_t inTime = GetMilliseconds();
+    SS.saveFile = "";
+    if(!SS.LoadFromFile(input)) return false;
+    SS.saveFile = input;
+    if(!SS.ReloadAllImported(/*canCancel=*/true)) return false;
+    t->load = GetMilliseconds() - inTime;
+    if(errorReported) return false;
+
+    // As after we open a file in the GUI, except that we solve every group
+    // without making any meshes, since the export makes those again at its
+    // own tolerance anyway.
+    SS.exportMode = false;
+    SS.GW.offset    = Vector::From(0, 0, 0);
+    SS.GW.projRight = Vector::From(1, 0, 0);
+    SS.GW.projUp    = Vector::From(0, 1, 0);
+    SS.GenerateAll(SolveSpaceUI::GENERATE_REGEN);
+    SS.TW.Init();
+    SS.GW.Init();
+    SS.GenerateAll(SolveSpaceUI::GENERATE_ALL, /*andFindFree=*/false,
+                   /*genForBBox=*/true);
+    TakeRegenTime(t);
+
+    for(int i = 0; i < SK.groupOrder.n; i++) {
+        Group *g = SK.GetGroup(SK.groupOrder.elem[i]);
+        if(!g->IsSolvedOkay()) {
+            fprintf(stderr, "solvespace-cli: warning: %s: group '%s' "
+                            "didn't solve\n",
+                    input.c_str(), g->DescriptionString().c_str());
+        }
+    }
+
+    SS.exportMode = true;
+    SS.GenerateAll(SolveSpaceUI::GENERATE_UNTIL_ACTIVE);
+    TakeRegenTime(t);
+
+    std::string output = OutputFor(opts.output, input);
+    inTime = GetMilliseconds();
+    switch(opts.cmd) {
+        case CMD_REGENERATE:
+            break;
+
+        case CMD_EXPORT_MESH:
+            SS.ExportMeshTo(output);
+            break;
+
+        case CMD_EXPORT_SURFACES: {
+            StepFileWriter sfw = {};
+            sfw.ExportSurfacesTo(output);
+            break;
+        }
+
+        case CMD_EXPORT_VIEW: {
+            Vector u = Views[opts.view].projRight,
+                   v = Views[opts.view].projUp;
+            SS.GW.projRight = u.WithMagnitude(1);
+            SS.GW.projUp    = v.WithMagnitude(1);
+            SS.ExportViewOrWireframeTo(output, /*wireframe=*/false);
+            break;
+        }
+
+        case CMD_EXPORT_WIREFRAME:
+            SS.ExportViewOrWireframeTo(output, /*wireframe=*/true);
+            break;
+    }
+    // The export regenerates too, though mostly it finds the shells that
+    // we've just made; so count any real work there in its own phase.
+    t->write = GetMilliseconds() - inTime;
+    t->write -= TakeRegenTime(t);
+
+    return !errorReported;
+}
+
+// One model to process, and what came of it. That's all there is to a job,
+// because the rest of what a model needs, from the sketch to the solver to
+// the temporary heap, is global; so in parallel each job must be processed
+// in a process of its own.
+struct Job {
+    std::string input;
+    bool        ok;
+    Timing      timing;
+};
+
+static void ReportJob(const Job &job, const Options &opts) {
+    if(!job.ok) {
+        fprintf(stderr, "solvespace-cli: %s: failed\n", job.input.c_str());
+    } else if(opts.timing) {
+        const Timing &t = job.timing;
+        printf("%s\t%lld\t%lld\t%lld\t%lld\t%lld\n", job.input.c_str(),
+               (long long)t.load, (long long)t.solve, (long long)t.boolean,
+               (long long)t.triangulate, (long long)t.write);
+        fflush(stdout);
+    }
+}
+
+// Process up to opts.jobs files at once, each in a child process, that
+// hands back its result through a pipe. The children share out the cores
+// between them, rather than each starting a worker thread for every core.
+// We report the jobs in the order that they were given, so that the
+// timing table doesn't depend on which one finished first.
+static void RunJobsInParallel(std::vector<Job> *jobs, const Options &opts) {
+    struct Child {
+        pid_t  pid;
+        int    fd;
+        size_t job;
+    };
+    std::vector<Child> running;
+    std::vector<bool>  finished(jobs->size());
+    size_t next = 0, reported = 0;
+
+    int threads = std::max(1, SS.GetWorkerThreads() / opts.jobs);
+    fflush(stdout);
+    fflush(stderr);
+
+    while(reported < jobs->size()) {
+        while(next < jobs->size() && (int)running.size() < opts.jobs) {
+            Job *job = &(*jobs)[next];
+            int fds[2];
+            if(pipe(fds) != 0) oops();
+            pid_t pid = fork();
+            if(pid < 0) oops();
+            if(pid == 0) {
+                close(fds[0]);
+                SS.workerThreads = threads;
+                job->ok = ProcessFile(job->input, opts, &job->timing);
+                // A Job is a few dozen bytes, less than PIPE_BUF, so this is
+                // written at once; and _exit, since our parent's atexit
+                // handlers and stdio buffers are not ours to flush.
+                fflush(stdout);
+                fflush(stderr);
+                if(write(fds[1], &job->ok, sizeof(job->ok)) < 0 ||
+                   write(fds[1], &job->timing, sizeof(job->timing)) < 0) {
+                    _exit(1);
+                }
+                _exit(0);
+            }
+            close(fds[1]);
+            running.push_back({ pid, fds[0], next });
+            next++;
+        }
+
+        int status;
+        pid_t pid = wait(&status);
+        if(pid < 0) oops();
+        for(size_t i = 0; i < running.size(); i++) {
+            Child c = running[i];
+            if(c.pid != pid) continue;
+
+            // If the child died before it wrote anything, e.g. because it
+            // crashed on this file, then that's a failure too.
+            Job *job = &(*jobs)[c.job];
+            job->ok = false;
+            bool ok;
+            if(read(c.fd, &ok, sizeof(ok)) == sizeof(ok) &&
+               read(c.fd, &job->timing, sizeof(job->timing)) ==
+                    sizeof(job->timing)) {
+                job->ok = ok;
+            }
+            close(c.fd);
+            finished[c.job] = true;
+            running.erase(running.begin() + i);
+            break;
+        }
+
+        while(reported < jobs->size() && finished[reported]) {
+            ReportJob((*jobs)[reported], opts);
+            reported++;
+        }
+    }
+}
+
+}
+
+using namespace SolveSpace;
+
+int main(int argc, char **argv) {
+    Options opts = {};
+    opts.jobs = 1;
+    std::vector<std::string> inputs;
+    if(!ParseArgs(argc, argv, &opts, &inputs)) {
+        ShowUsage();
+        return 1;
+    }
+
+    SS.headless = true;
+    SS.Init();
+    if(opts.chordTol > 0) {
+        SS.exportChordTol = opts.chordTol;
+    }
+
+    std::vector<Job> jobs(inputs.size());
+    for(size_t i = 0; i < inputs.size(); i++) {
+        jobs[i].input = inputs[i];
+    }
+
+    if(opts.timing) {
+        printf("file\tload\tsolve\tboolean\ttriangulate\twrite\n");
+    }
+    if(opts.jobs > 1 && jobs.size() > 1) {
+        RunJobsInParallel(&jobs, opts);
+    } else {
+        for(size_t i = 0; i < jobs.size(); i++) {
+            jobs[i].ok = ProcessFile(jobs[i].input, opts, &jobs[i].timing);
+            ReportJob(jobs[i], opts);
+        }
+    }
+
+    int failed = 0;
+    for(const Job &job : jobs) {
+        if(!job.ok) failed++;
+    }
+
+    SK.Clear();
+    SS.Clear();
+
+    return (failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,110 @@
+//-----------------------------------------------------------------------------
+// A triangle mesh with shared vertices: each vertex stored once, and the
+// triangles as indices into those, so that which triangles share an edge is
+// just a lookup, not a search by tolerance.
+//-----------------------------------------------------------------------------
+#include "solvespace.h"
+
+void SIndexedMesh::Clear(void) {
+    vertex.clear();
+    tri.clear();
+    normal.clear();
+    mate.clear();
+    grid.Clear();
+}
+
+//-----------------------------------------------------------------------------
+// Return the index of a vertex equal to p, adding one if there's none yet.
+// If several are equal to p, then that's the first one, as for an
+// SPointList.
+//-----------------------------------------------------------------------------
+int SIndexedMesh::AddVertex(Vector p) {
+    int found = -1;
+    grid.ForEachNear(p, [&](int i) {
+        if(found >= 0 && i >= found) return;
+        if(p.Equals(vertex[i])) found = i;
+    });
+    if(found >= 0) return found;
+
+    vertex.push_back(p);
+    grid.Add(p, (int)vertex.size() - 1);
+    return (int)vertex.size() - 1;
+}
+
+void SIndexedMesh::AddTriangle(STriangle *tr, bool withNormals) {
+    Triangle t = {};
+    t.v[0] = AddVertex(tr->a);
+    t.v[1] = AddVertex(tr->b);
+    t.v[2] = AddVertex(tr->c);
+    t.meta = tr->meta;
+    tri.push_back(t);
+
+    if(withNormals) {
+        normal.push_back(tr->an);
+        normal.push_back(tr->bn);
+        normal.push_back(tr->cn);
+    }
+    mate.clear();
+}
+
+void SIndexedMesh::MakeFromMesh(SMesh *m, bool withNormals) {
+    tri.reserve(tri.size() + m->l.n);
+    if(withNormals) normal.reserve(normal.size() + 3*m->l.n);
+
+    int i;
+    for(i = 0; i < m->l.n; i++) {
+        AddTriangle(&(m->l.elem[i]), withNormals);
+    }
+}
+
+void SIndexedMesh::MakeMeshInto(SMesh *m) {
+    size_t i;
+    for(i = 0; i < tri.size(); i++) {
+        Triangle *t = &(tri[i]);
+        STriangle tr = {};
+        tr.meta = t->meta;
+        tr.a = vertex[t->v[0]];
+        tr.b = vertex[t->v[1]];
+        tr.c = vertex[t->v[2]];
+        if(!normal.empty()) {
+            tr.an = normal[3*i];
+            tr.bn = normal[3*i + 1];
+            tr.cn = normal[3*i + 2];
+        }
+        m->l.Add(&tr);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Pair up each half-edge with the half-edge that runs back the other way
+// along it, if there's exactly one such; a naked edge has none, and where
+// the mesh isn't manifold there may be more than one.
+//-----------------------------------------------------------------------------
+void SIndexedMesh::FindMates(void) {
+    // Keyed by the half-edge's two vertices; or -2 if there are several
+    // half-edges with the same two vertices in the same order.
+    std::unordered_map<uint64_t, int> halfEdges;
+    halfEdges.reserve(3*tri.size());
+
+    int he;
+    for(he = 0; he < 3*(int)tri.size(); he++) {
+        uint64_t key = ((uint64_t)From(he) << 32) | (uint32_t)To(he);
+        auto ins = halfEdges.emplace(key, he);
+        if(!ins.second) ins.first->second = -2;
+    }
+
+    mate.assign(3*tri.size(), -1);
+    for(he = 0; he < 3*(int)tri.size(); he++) {
+        uint64_t key = ((uint64_t)To(he) << 32) | (uint32_t)From(he);
+        auto it = halfEdges.find(key);
+        if(it != halfEdges.end() && it->second >= 0) mate[he] = it->second;
+    }
+}
+
+Vector SIndexedMesh::Normal(int i) {
+    Vector a = vertex[tri[i].v[0]],
+           b = vertex[tri[i].v[1]],
+           c = vertex[tri[i].v[2]];
+    Vector ab = b.Minus(a), bc = c.Minus(b);
+    return ab.Cross(bc);
+}
@@ -225,10 +225,6 @@ default: dbp("bad constraint type %d", sc->type); return;
             ssys->result = SLVS_RESULT_INCONSISTENT;
             break;
 
-        case System::TOO_MANY_UNKNOWNS:
-            ssys->result = SLVS_RESULT_TOO_MANY_UNKNOWNS;
-            break;
-
         default: oops();
     }
 
@@ -92,9 +92,14 @@ void SMesh::MakeEdgesInPlaneInto(SEdgeList *sel, Vector n, double d) {
 }
 
 void SMesh::MakeCertainEdgesAndOutlinesInto(SEdgeList *sel, SOutlineList *sol, int type) {
-    SKdNode *root = SKdNode::From(this);
-    root->MakeCertainEdgesInto(sel, type, false, NULL, NULL);
-    root->MakeOutlinesInto(sol);
+    // These depend only on how the triangles join up, so there's no need for
+    // the kd-tree that would let us look for self-intersections too.
+    SIndexedMesh im = {};
+    im.MakeFromMesh(this, /*withNormals=*/(type == SKdNode::SHARP_EDGES));
+    im.FindMates();
+    im.MakeCertainEdgesInto(sel, type);
+    im.MakeOutlinesInto(sol);
+    im.Clear();
 }
 
 //-----------------------------------------------------------------------------
@@ -369,10 +374,13 @@ SKdNode *SKdNode::From(SMesh *m) {
         tra[i] = m->l.elem[i];
     }
 
-    srand(0);
+    // Shuffle them, so that the tree comes out balanced; the same way every
+    // time, but without touching the global state of rand().
+    uint32_t seed = 0;
     int n = m->l.n;
     while(n > 1) {
-        int k = rand() % n;
+        seed = seed*1103515245 + 12345;
+        int k = (int)((seed >> 8) % (uint32_t)n);
         n--;
         swap(tra[k], tra[n]);
     }
@@ -649,155 +657,6 @@ void SKdNode::SnapToMesh(SMesh *m) {
     }
 }
 
-//-----------------------------------------------------------------------------
-// For all the edges in sel, split them against the given triangle, and test
-// them for occlusion. Keep only the visible segments. sel is both our input
-// and our output.
-//-----------------------------------------------------------------------------
-void SKdNode::SplitLinesAgainstTriangle(SEdgeList *sel, STriangle *tr, bool removeHidden) {
-    SEdgeList seln = {};
-
-    Vector tn = tr->Normal().WithMagnitude(1);
-    double td = tn.Dot(tr->a);
-
-    // Consider front-facing triangles only.
-    if(tn.z > LENGTH_EPS) {
-        // If the edge crosses our triangle's plane, then split into above
-        // and below parts. Note that we must preserve auxA, which contains
-        // the style associated with this line.
-        SEdge *se;
-        for(se = sel->l.First(); se; se = sel->l.NextAfter(se)) {
-            double da = (se->a).Dot(tn) - td,
-                   db = (se->b).Dot(tn) - td;
-            if((da < -LENGTH_EPS && db > LENGTH_EPS) ||
-               (db < -LENGTH_EPS && da > LENGTH_EPS))
-            {
-                Vector m = Vector::AtIntersectionOfPlaneAndLine(
-                                        tn, td,
-                                        se->a, se->b, NULL);
-                seln.AddEdge(m, se->b, se->auxA);
-                se->b = m;
-            }
-        }
-        for(se = seln.l.First(); se; se = seln.l.NextAfter(se)) {
-            sel->AddEdge(se->a, se->b, se->auxA);
-        }
-        seln.Clear();
-
-        for(se = sel->l.First(); se; se = sel->l.NextAfter(se)) {
-            Vector pt = ((se->a).Plus(se->b)).ScaledBy(0.5);
-            if(pt.Dot(tn) - td > -LENGTH_EPS) {
-                // Edge is in front of or on our plane (remember, tn.z > 0)
-                // so it is exempt from further splitting
-                se->auxB = 1;
-            } else {
-                // Edge is behind our plane, needs further splitting
-                se->auxB = 0;
-            }
-        }
-
-        // Considering only the (x, y) coordinates, split the edge against our
-        // triangle.
-        Point2d a = (tr->a).ProjectXy(),
-                b = (tr->b).ProjectXy(),
-                c = (tr->c).ProjectXy();
-
-        Point2d n[3] = { (b.Minus(a)).Normal().WithMagnitude(1),
-                         (c.Minus(b)).Normal().WithMagnitude(1),
-                         (a.Minus(c)).Normal().WithMagnitude(1)  };
-
-        double d[3] = { n[0].Dot(b),
-                        n[1].Dot(c),
-                        n[2].Dot(a)  };
-
-        // Split all of the edges where they intersect the triangle edges
-        int i;
-        for(i = 0; i < 3; i++) {
-            for(se = sel->l.First(); se; se = sel->l.NextAfter(se)) {
-                if(se->auxB) continue;
-
-                Point2d ap = (se->a).ProjectXy(),
-                        bp = (se->b).ProjectXy();
-                double da = n[i].Dot(ap) - d[i],
-                       db = n[i].Dot(bp) - d[i];
-                if((da < -LENGTH_EPS && db > LENGTH_EPS) ||
-                   (db < -LENGTH_EPS && da > LENGTH_EPS))
-                {
-                    double dab = (db - da);
-                    Vector spl = ((se->a).ScaledBy( db/dab)).Plus(
-                                  (se->b).ScaledBy(-da/dab));
-                    seln.AddEdge(spl, se->b, se->auxA);
-                    se->b = spl;
-                }
-            }
-            for(se = seln.l.First(); se; se = seln.l.NextAfter(se)) {
-                // The split pieces are all behind the triangle, since only
-                // edges behind the triangle got split. So their auxB is 0.
-                sel->AddEdge(se->a, se->b, se->auxA, 0);
-            }
-            seln.Clear();
-        }
-
-        for(se = sel->l.First(); se; se = sel->l.NextAfter(se)) {
-            if(se->auxB) {
-                // Lies above or on the triangle plane, so triangle doesn't
-                // occlude it.
-                se->tag = 0;
-            } else {
-                // Test the segment to see if it lies outside the triangle
-                // (i.e., outside wrt at least one edge), and keep it only
-                // then.
-                Point2d pt = ((se->a).Plus(se->b).ScaledBy(0.5)).ProjectXy();
-                se->tag = 1;
-                for(i = 0; i < 3; i++) {
-                    // If the test point lies on the boundary of our triangle,
-                    // then we still discard the edge.
-                    if(n[i].Dot(pt) - d[i] > LENGTH_EPS) se->tag = 0;
-                }
-            }
-            if(!removeHidden && se->tag == 1)
-                se->auxA = Style::HIDDEN_EDGE;
-        }
-        if(removeHidden)
-            sel->l.RemoveTagged();
-    }
-}
-
-//-----------------------------------------------------------------------------
-// Given an edge orig, occlusion test it against our mesh. We output an edge
-// list in sel, containing the visible portions of that edge.
-//-----------------------------------------------------------------------------
-void SKdNode::OcclusionTestLine(SEdge orig, SEdgeList *sel, int cnt, bool removeHidden) {
-    if(gt && lt) {
-        double ac = (orig.a).Element(which),
-               bc = (orig.b).Element(which);
-        // We can ignore triangles that are separated in x or y, but triangles
-        // that are separated in z may still contribute
-        if(ac < c + KDTREE_EPS ||
-           bc < c + KDTREE_EPS ||
-           which == 2)
-        {
-            lt->OcclusionTestLine(orig, sel, cnt, removeHidden);
-        }
-        if(ac > c - KDTREE_EPS ||
-           bc > c - KDTREE_EPS ||
-           which == 2)
-        {
-            gt->OcclusionTestLine(orig, sel, cnt, removeHidden);
-        }
-    } else {
-        STriangleLl *ll;
-        for(ll = tris; ll; ll = ll->next) {
-            STriangle *tr = ll->tri;
-
-            if(tr->tag == cnt) continue;
-
-            SplitLinesAgainstTriangle(sel, tr, removeHidden);
-            tr->tag = cnt;
-        }
-    }
-}
-
 //-----------------------------------------------------------------------------
 // Search the mesh for a triangle with an edge from b to a (i.e., the mate
 // for the edge from a to b), and increment info->count each time that we
@@ -1047,6 +906,81 @@ void SKdNode::MakeOutlinesInto(SOutlineList *sol)
     }
 }
 
+//-----------------------------------------------------------------------------
+// The same as SKdNode::MakeCertainEdgesInto, for the classes of edges that
+// depend only on how the triangles join up (so not naked or self-intersecting
+// edges), but with the mates of the edges already known.
+//-----------------------------------------------------------------------------
+void SIndexedMesh::MakeCertainEdgesInto(SEdgeList *sel, int how, int auxA) {
+    if(mate.size() != 3*tri.size()) FindMates();
+
+    int he;
+    for(he = 0; he < (int)mate.size(); he++) {
+        int m = mate[he];
+        if(m < 0) continue;
+
+        int i = he/3, j = m/3;
+        Vector a = vertex[From(he)], b = vertex[To(he)];
+
+        if(how == SKdNode::TURNING_EDGES) {
+            // This triangle is back-facing (or on edge), and its mate is
+            // front-facing. Only one of the pair can be, so this reports
+            // each edge once.
+            if(Normal(i).z < LENGTH_EPS && Normal(j).z > LENGTH_EPS) {
+                sel->AddEdge(a, b, auxA);
+            }
+            continue;
+        }
+
+        // Otherwise, report each edge from only one of its half-edges.
+        if(mate[m] == he && m < he) continue;
+
+        switch(how) {
+            case SKdNode::EMPHASIZED_EDGES:
+                // The two triangles that join at this edge come from
+                // different faces; either really different faces, or one is
+                // from a face and the other is zero (i.e., not from a face).
+                if(tri[i].meta.face != tri[j].meta.face) {
+                    sel->AddEdge(a, b, auxA);
+                }
+                break;
+
+            case SKdNode::SHARP_EDGES: {
+                if(normal.empty()) oops();
+                // The mate runs from b back to a.
+                Vector na0 = normal[he].WithMagnitude(1.0),
+                       nb0 = normal[3*i + (he%3 + 1)%3].WithMagnitude(1.0),
+                       nb1 = normal[m].WithMagnitude(1.0),
+                       na1 = normal[3*j + (m%3 + 1)%3].WithMagnitude(1.0);
+                if(!((na0.Equals(na1) && nb0.Equals(nb1)) ||
+                     (na0.Equals(nb1) && nb0.Equals(na1)))) {
+                    // The two triangles that join at this edge meet at a
+                    // sharp angle. This implies they come from different
+                    // faces.
+                    sel->AddEdge(a, b, auxA);
+                }
+                break;
+            }
+
+            default: oops();
+        }
+    }
+}
+
+void SIndexedMesh::MakeOutlinesInto(SOutlineList *sol) {
+    if(mate.size() != 3*tri.size()) FindMates();
+
+    int he;
+    for(he = 0; he < (int)mate.size(); he++) {
+        int m = mate[he];
+        if(m < 0) continue;
+        if(mate[m] == he && m < he) continue;
+
+        sol->AddEdge(vertex[From(he)], vertex[To(he)],
+                     Normal(he/3), Normal(m/3));
+    }
+}
+
 void SOutlineList::Clear() {
     l.Clear();
 }
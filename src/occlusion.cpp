@@ -0,0 +1,235 @@
+//-----------------------------------------------------------------------------
+// Hidden line removal for the vector export: a hierarchy of boxes on the page
+// over the mesh's triangles, and the splitting of edges against whichever
+// triangles might hide them.
+//-----------------------------------------------------------------------------
+#include "solvespace.h"
+
+//-----------------------------------------------------------------------------
+// Build the hierarchy over the front-facing triangles of m, which must have
+// been projected already.
+//-----------------------------------------------------------------------------
+void SOcclusionBvh::Build(SMesh *m) {
+    tri.clear();
+    for(int i = 0; i < m->l.n; i++) {
+        STriangle *tr = &(m->l.elem[i]);
+        // The same test as in SplitLinesAgainstTriangle(), which ignores
+        // everything else.
+        if(tr->Normal().WithMagnitude(1).z > LENGTH_EPS) tri.push_back(*tr);
+    }
+
+    node.clear();
+    if(!tri.empty()) BuildNode(0, (int)tri.size());
+}
+
+void SOcclusionBvh::Clear(void) {
+    node.clear();
+    tri.clear();
+}
+
+//-----------------------------------------------------------------------------
+// Make a node for the triangles in [first, last) of tri, splitting them at
+// the median along x or y, whichever their centers are more spread out in.
+// Returns the index of the new node.
+//-----------------------------------------------------------------------------
+int SOcclusionBvh::BuildNode(int first, int last) {
+    static const int LEAF_SIZE = 4;
+    int i;
+
+    Node nd = {};
+    nd.max  = Point2d::From(VERY_NEGATIVE, VERY_NEGATIVE);
+    nd.min  = Point2d::From(VERY_POSITIVE, VERY_POSITIVE);
+    nd.zmax = VERY_NEGATIVE;
+    Point2d cmax = nd.max, cmin = nd.min;
+    for(i = first; i < last; i++) {
+        STriangle *tr = &tri[i];
+        for(Vector v : { tr->a, tr->b, tr->c }) {
+            nd.max.x = max(nd.max.x, v.x);  nd.min.x = min(nd.min.x, v.x);
+            nd.max.y = max(nd.max.y, v.y);  nd.min.y = min(nd.min.y, v.y);
+            nd.zmax  = max(nd.zmax, v.z);
+        }
+        Vector c = ((tr->a).Plus(tr->b).Plus(tr->c)).ScaledBy(1.0/3);
+        cmax.x = max(cmax.x, c.x);  cmin.x = min(cmin.x, c.x);
+        cmax.y = max(cmax.y, c.y);  cmin.y = min(cmin.y, c.y);
+    }
+    nd.left = nd.right = -1;
+    nd.first = first;
+    nd.last  = last;
+
+    int r = (int)node.size();
+    node.push_back(nd);
+    if(last - first <= LEAF_SIZE) return r;
+
+    bool alongX = (cmax.x - cmin.x > cmax.y - cmin.y);
+    int mid = (first + last)/2;
+    std::nth_element(tri.begin() + first, tri.begin() + mid,
+                     tri.begin() + last, [&](const STriangle &a,
+                                             const STriangle &b) {
+        return alongX ? (a.a.x + a.b.x + a.c.x < b.a.x + b.b.x + b.c.x)
+                      : (a.a.y + a.b.y + a.c.y < b.a.y + b.b.y + b.c.y);
+    });
+
+    int left  = BuildNode(first, mid);
+    int right = BuildNode(mid, last);
+    node[r].left  = left;
+    node[r].right = right;
+    return r;
+}
+
+//-----------------------------------------------------------------------------
+// For all the edges in sel, split them against the given triangle, and test
+// them for occlusion. Keep only the visible segments. sel is both our input
+// and our output.
+//-----------------------------------------------------------------------------
+void SOcclusionBvh::SplitLinesAgainstTriangle(SEdgeList *sel, STriangle *tr,
+                                              bool removeHidden)
+{
+    SEdgeList seln = {};
+
+    Vector tn = tr->Normal().WithMagnitude(1);
+    double td = tn.Dot(tr->a);
+
+    // Consider front-facing triangles only.
+    if(tn.z > LENGTH_EPS) {
+        // If the edge crosses our triangle's plane, then split into above
+        // and below parts. Note that we must preserve auxA, which contains
+        // the style associated with this line.
+        SEdge *se;
+        for(se = sel->l.First(); se; se = sel->l.NextAfter(se)) {
+            double da = (se->a).Dot(tn) - td,
+                   db = (se->b).Dot(tn) - td;
+            if((da < -LENGTH_EPS && db > LENGTH_EPS) ||
+               (db < -LENGTH_EPS && da > LENGTH_EPS))
+            {
+                Vector m = Vector::AtIntersectionOfPlaneAndLine(
+                                        tn, td,
+                                        se->a, se->b, NULL);
+                seln.AddEdge(m, se->b, se->auxA);
+                se->b = m;
+            }
+        }
+        for(se = seln.l.First(); se; se = seln.l.NextAfter(se)) {
+            sel->AddEdge(se->a, se->b, se->auxA);
+        }
+        seln.Clear();
+
+        for(se = sel->l.First(); se; se = sel->l.NextAfter(se)) {
+            Vector pt = ((se->a).Plus(se->b)).ScaledBy(0.5);
+            if(pt.Dot(tn) - td > -LENGTH_EPS) {
+                // Edge is in front of or on our plane (remember, tn.z > 0)
+                // so it is exempt from further splitting
+                se->auxB = 1;
+            } else {
+                // Edge is behind our plane, needs further splitting
+                se->auxB = 0;
+            }
+        }
+
+        // Considering only the (x, y) coordinates, split the edge against our
+        // triangle.
+        Point2d a = (tr->a).ProjectXy(),
+                b = (tr->b).ProjectXy(),
+                c = (tr->c).ProjectXy();
+
+        Point2d n[3] = { (b.Minus(a)).Normal().WithMagnitude(1),
+                         (c.Minus(b)).Normal().WithMagnitude(1),
+                         (a.Minus(c)).Normal().WithMagnitude(1)  };
+
+        double d[3] = { n[0].Dot(b),
+                        n[1].Dot(c),
+                        n[2].Dot(a)  };
+
+        // Split all of the edges where they intersect the triangle edges
+        int i;
+        for(i = 0; i < 3; i++) {
+            for(se = sel->l.First(); se; se = sel->l.NextAfter(se)) {
+                if(se->auxB) continue;
+
+                Point2d ap = (se->a).ProjectXy(),
+                        bp = (se->b).ProjectXy();
+                double da = n[i].Dot(ap) - d[i],
+                       db = n[i].Dot(bp) - d[i];
+                if((da < -LENGTH_EPS && db > LENGTH_EPS) ||
+                   (db < -LENGTH_EPS && da > LENGTH_EPS))
+                {
+                    double dab = (db - da);
+                    Vector spl = ((se->a).ScaledBy( db/dab)).Plus(
+                                  (se->b).ScaledBy(-da/dab));
+                    seln.AddEdge(spl, se->b, se->auxA);
+                    se->b = spl;
+                }
+            }
+            for(se = seln.l.First(); se; se = seln.l.NextAfter(se)) {
+                // The split pieces are all behind the triangle, since only
+                // edges behind the triangle got split. So their auxB is 0.
+                sel->AddEdge(se->a, se->b, se->auxA, 0);
+            }
+            seln.Clear();
+        }
+
+        for(se = sel->l.First(); se; se = sel->l.NextAfter(se)) {
+            if(se->auxB) {
+                // Lies above or on the triangle plane, so triangle doesn't
+                // occlude it.
+                se->tag = 0;
+            } else {
+                // Test the segment to see if it lies outside the triangle
+                // (i.e., outside wrt at least one edge), and keep it only
+                // then.
+                Point2d pt = ((se->a).Plus(se->b).ScaledBy(0.5)).ProjectXy();
+                se->tag = 1;
+                for(i = 0; i < 3; i++) {
+                    // If the test point lies on the boundary of our triangle,
+                    // then we still discard the edge.
+                    if(n[i].Dot(pt) - d[i] > LENGTH_EPS) se->tag = 0;
+                }
+            }
+            if(!removeHidden && se->tag == 1)
+                se->auxA = Style::HIDDEN_EDGE;
+        }
+        if(removeHidden)
+            sel->l.RemoveTagged();
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Given an edge orig, occlusion test it against our mesh. We output an edge
+// list in sel, containing the visible portions of that edge. A triangle can
+// hide some of the edge only if it overlaps the edge on the page, and if some
+// of it is nearer than the farthest end of the edge; so we skip any node
+// whose triangles are all too far away either way. This doesn't modify the
+// hierarchy, so it's safe to test many edges at once on different threads.
+//-----------------------------------------------------------------------------
+void SOcclusionBvh::OcclusionTestLine(SEdge orig, SEdgeList *sel,
+                                      bool removeHidden)
+{
+    if(node.empty()) return;
+
+    Point2d emax = Point2d::From(max(orig.a.x, orig.b.x) + LENGTH_EPS,
+                                 max(orig.a.y, orig.b.y) + LENGTH_EPS),
+            emin = Point2d::From(min(orig.a.x, orig.b.x) - LENGTH_EPS,
+                                 min(orig.a.y, orig.b.y) - LENGTH_EPS);
+    double ezmin = min(orig.a.z, orig.b.z) - LENGTH_EPS;
+
+    int stack[64], depth = 0;
+    stack[depth++] = 0;
+    while(depth > 0) {
+        Node *nd = &node[stack[--depth]];
+        if(nd->zmax < ezmin) continue;
+        if(nd->max.x < emin.x || nd->min.x > emax.x ||
+           nd->max.y < emin.y || nd->min.y > emax.y) continue;
+
+        if(nd->left < 0) {
+            for(int i = nd->first; i < nd->last; i++) {
+                STriangle *tr = &tri[i];
+                if(max(tr->a.z, max(tr->b.z, tr->c.z)) < ezmin) continue;
+                SplitLinesAgainstTriangle(sel, tr, removeHidden);
+            }
+            // Once it's all hidden, there's nothing left to split.
+            if(sel->l.n == 0) return;
+        } else {
+            stack[depth++] = nd->left;
+            stack[depth++] = nd->right;
+        }
+    }
+}
@@ -158,34 +158,31 @@ void SEdgeList::AddEdge(Vector a, Vector b, int auxA, int auxB) {
     l.Add(&e);
 }
 
+//-----------------------------------------------------------------------------
+// Chain edges onto the contour that starts with first and last, until it
+// closes. The next edge is always the first one in the list that continues
+// from last; ends holds the endpoints of every edge, so we can find that
+// without searching the whole list.
+//-----------------------------------------------------------------------------
 bool SEdgeList::AssembleContour(Vector first, Vector last, SContour *dest,
-                                SEdge *errorAt, bool keepDir)
+                                SEdge *errorAt, bool keepDir, SPointGrid *ends)
 {
-    int i;
-
     dest->AddPoint(first);
     dest->AddPoint(last);
 
     do {
-        for(i = 0; i < l.n; i++) {
-            SEdge *se = &(l.elem[i]);
-            if(se->tag) continue;
+        int next = -1;
+        ends->ForEachNear(last, [&](int i) {
+            if(next >= 0 && i >= next) return;
 
-            if(se->a.Equals(last)) {
-                dest->AddPoint(se->b);
-                last = se->b;
-                se->tag = 1;
-                break;
-            }
+            SEdge *se = &(l.elem[i]);
+            if(se->tag) return;
             // Don't allow backwards edges if keepDir is true.
-            if(!keepDir && se->b.Equals(last)) {
-                dest->AddPoint(se->a);
-                last = se->a;
-                se->tag = 1;
-                break;
+            if(se->a.Equals(last) || (!keepDir && se->b.Equals(last))) {
+                next = i;
             }
-        }
-        if(i >= l.n) {
+        });
+        if(next < 0) {
             // Couldn't assemble a closed contour; mark where.
             if(errorAt) {
                 errorAt->a = first;
@@ -194,6 +191,15 @@ bool SEdgeList::AssembleContour(Vector first, Vector last, SContour *dest,
             return false;
         }
 
+        SEdge *se = &(l.elem[next]);
+        if(se->a.Equals(last)) {
+            dest->AddPoint(se->b);
+            last = se->b;
+        } else {
+            dest->AddPoint(se->a);
+            last = se->a;
+        }
+        se->tag = 1;
     } while(!last.Equals(first));
 
     return true;
@@ -202,12 +208,21 @@ bool SEdgeList::AssembleContour(Vector first, Vector last, SContour *dest,
 bool SEdgeList::AssemblePolygon(SPolygon *dest, SEdge *errorAt, bool keepDir) {
     dest->Clear();
 
+    SPointGrid ends = {};
+    int i;
+    for(i = 0; i < l.n; i++) {
+        ends.Add(l.elem[i].a, i);
+        ends.Add(l.elem[i].b, i);
+    }
+
     bool allClosed = true;
+    // Edges only ever get tagged here, so no need to look before the first
+    // one that was still untagged last time.
+    int start = 0;
     for(;;) {
         Vector first = Vector::From(0, 0, 0);
         Vector last  = Vector::From(0, 0, 0);
-        int i;
-        for(i = 0; i < l.n; i++) {
+        for(i = start; i < l.n; i++) {
             if(!l.elem[i].tag) {
                 first = l.elem[i].a;
                 last = l.elem[i].b;
@@ -218,12 +233,13 @@ bool SEdgeList::AssemblePolygon(SPolygon *dest, SEdge *errorAt, bool keepDir) {
         if(i >= l.n) {
             return allClosed;
         }
+        start = i + 1;
 
         // Create a new empty contour in our polygon, and finish assembling
         // into that contour.
         dest->AddEmptyContour();
         if(!AssembleContour(first, last, &(dest->l.elem[dest->l.n-1]),
-                errorAt, keepDir))
+                errorAt, keepDir, &ends))
         {
             allClosed = false;
         }
@@ -431,21 +447,14 @@ int SKdNodeEdges::AnyEdgeCrossings(Vector a, Vector b, int cnt,
 // We have an edge list that contains only collinear edges, maybe with more
 // splits than necessary. Merge any collinear segments that join.
 //-----------------------------------------------------------------------------
-static Vector LineStart, LineDirection;
-static int ByTAlongLine(const void *av, const void *bv)
-{
-    SEdge *a = (SEdge *)av,
-          *b = (SEdge *)bv;
-
-    double ta = (a->a.Minus(LineStart)).DivPivoting(LineDirection),
-           tb = (b->a.Minus(LineStart)).DivPivoting(LineDirection);
-
-    return (ta > tb) ? 1 : -1;
-}
 void SEdgeList::MergeCollinearSegments(Vector a, Vector b) {
-    LineStart = a;
-    LineDirection = b.Minus(a);
-    qsort(l.elem, l.n, sizeof(l.elem[0]), ByTAlongLine);
+    // Sort by where they start along the line; this may run on many threads
+    // at once, so the line can't be a static for qsort's comparator.
+    Vector d = b.Minus(a);
+    auto tAlongLine = [&](Vector p) { return (p.Minus(a)).DivPivoting(d); };
+    std::sort(l.elem, l.elem + l.n, [&](const SEdge &ea, const SEdge &eb) {
+        return tAlongLine(ea.a) < tAlongLine(eb.a);
+    });
 
     l.ClearTags();
     int i;
@@ -462,8 +471,70 @@ void SEdgeList::MergeCollinearSegments(Vector a, Vector b) {
     l.RemoveTagged();
 }
 
+const double SPointGrid::CELL = 64*LENGTH_EPS;
+
+void SPointGrid::Clear(void) {
+    bucket.clear();
+    entry.clear();
+}
+
+int SPointGrid::BucketOf(int64_t x, int64_t y, int64_t z) {
+    uint64_t h = HashMix(0, (uint64_t)x);
+    h = HashMix(h, (uint64_t)y);
+    h = HashMix(h, (uint64_t)z);
+    return (int)(h & (bucket.size() - 1));
+}
+
+void SPointGrid::Add(Vector p, int id) {
+    Entry e = {};
+    e.x = CellOf(p.x);
+    e.y = CellOf(p.y);
+    e.z = CellOf(p.z);
+    e.id = id;
+    entry.push_back(e);
+
+    if(entry.size() > bucket.size()) {
+        // Keep the chains short; rehash everything into twice as many
+        // buckets.
+        bucket.assign(std::max((size_t)64, bucket.size()*2), -1);
+        int i;
+        for(i = 0; i < (int)entry.size(); i++) {
+            Entry *ei = &(entry[i]);
+            int b = BucketOf(ei->x, ei->y, ei->z);
+            ei->next = bucket[b];
+            bucket[b] = i;
+        }
+    } else {
+        Entry *ei = &(entry.back());
+        int b = BucketOf(ei->x, ei->y, ei->z);
+        ei->next = bucket[b];
+        bucket[b] = (int)entry.size() - 1;
+    }
+}
+
 void SPointList::Clear(void) {
     l.Clear();
+    grid.Clear();
+}
+
+void SPointList::RemoveTagged(void) {
+    l.RemoveTagged();
+    grid.Clear();
+}
+
+//-----------------------------------------------------------------------------
+// Make sure that the grid indexes every point in the list, and return true;
+// or if the list is short enough that a linear search is quicker, then
+// return false.
+//-----------------------------------------------------------------------------
+bool SPointList::UpdateGrid(void) {
+    if(l.n < MIN_FOR_GRID) return false;
+
+    int i;
+    for(i = (int)grid.entry.size(); i < l.n; i++) {
+        grid.Add(l.elem[i].p, i);
+    }
+    return true;
 }
 
 bool SPointList::ContainsPoint(Vector pt) {
@@ -471,6 +542,15 @@ bool SPointList::ContainsPoint(Vector pt) {
 }
 
 int SPointList::IndexForPoint(Vector pt) {
+    if(UpdateGrid()) {
+        int found = -1;
+        grid.ForEachNear(pt, [&](int i) {
+            if(found >= 0 && i >= found) return;
+            if(pt.Equals(l.elem[i].p)) found = i;
+        });
+        return found;
+    }
+
     int i;
     for(i = 0; i < l.n; i++) {
         SPoint *p = &(l.elem[i]);
@@ -483,12 +563,10 @@ int SPointList::IndexForPoint(Vector pt) {
 }
 
 void SPointList::IncrementTagFor(Vector pt) {
-    SPoint *p;
-    for(p = l.First(); p; p = l.NextAfter(p)) {
-        if(pt.Equals(p->p)) {
-            (p->tag)++;
-            return;
-        }
+    int i = IndexForPoint(pt);
+    if(i >= 0) {
+        (l.elem[i].tag)++;
+        return;
     }
     SPoint pa;
     pa.p = pt;
@@ -867,3 +945,479 @@ void SContour::OffsetInto(SContour *dest, double r) {
     }
 }
 
+
+//-----------------------------------------------------------------------------
+// Triangulate a polygon in the xy plane in O(n log n), by sweeping a line
+// down through its vertices to cut it into y-monotone pieces, and then
+// triangulating each of those in linear time; see de Berg et al.,
+// "Computational Geometry", chapter 3. This takes all the contours at once,
+// so holes need no bridges, and it works out for itself which contours are
+// holes, from whatever lies to the left of a contour's top vertex when the
+// sweep line reaches it.
+//-----------------------------------------------------------------------------
+class MonotoneTriangulator {
+public:
+    enum { START = 0, END, SPLIT, MERGE, REGULAR };
+
+    struct EdgeLess {
+        MonotoneTriangulator *t;
+        bool operator()(int a, int b) const { return t->EdgeBefore(a, b); }
+    };
+    typedef std::set<int, EdgeLess> EdgeSet;
+
+    // Edge i runs from vertex i to vertex next; its helper and position in
+    // the sweep status are stored with vertex i.
+    struct Vertex {
+        Point2d             p;
+        int                 next, prev;
+        int                 contour;
+        int                 type;
+        int                 helper;
+        bool                interiorRight;
+        bool                inStatus;
+        EdgeSet::iterator   where;
+        std::vector<int>    diagonals;
+        bool                usedNext;
+        std::vector<bool>   usedDiagonal;
+    };
+
+    struct Contour {
+        int                 first, n;
+        double              area;
+        bool                oriented;
+    };
+
+    std::vector<Vertex>     v;
+    std::vector<Contour>    contours;
+    EdgeSet                 status;
+    Point2d                 sweep;
+    double                  scaledEps;
+    double                  triArea;
+    std::vector<STriangle>  out;
+    bool                    failed;
+
+    MonotoneTriangulator(double eps) :
+        status(EdgeLess { this }), scaledEps(eps), triArea(0), failed(false) {}
+
+    void AddContour(SContour *sc) {
+        // Drop the closing point, and any zero-length edges.
+        std::vector<Vector> pts;
+        for(int i = 0; i < sc->l.n; i++) {
+            Vector p = sc->l.elem[i].p;
+            if(!pts.empty() && p.Equals(pts.back())) continue;
+            pts.push_back(p);
+        }
+        while(pts.size() > 1 && pts.back().Equals(pts.front())) pts.pop_back();
+        if(pts.size() < 3) return;
+
+        Contour c = {};
+        c.first = (int)v.size();
+        c.n = (int)pts.size();
+        for(int i = 0; i < c.n; i++) {
+            Vector p0 = pts[i], p1 = pts[(i + 1) % c.n];
+            c.area += (p0.x*p1.y - p1.x*p0.y)/2;
+
+            Vertex vt = {};
+            vt.p = Point2d::From(p0.x, p0.y);
+            vt.next = c.first + (i + 1) % c.n;
+            vt.prev = c.first + (i + c.n - 1) % c.n;
+            vt.contour = (int)contours.size();
+            vt.helper = -1;
+            v.push_back(vt);
+        }
+        contours.push_back(c);
+    }
+
+    // The order in which the sweep line meets the vertices: from top to
+    // bottom, and left to right along a horizontal line.
+    bool Above(int a, int b) const {
+        const Point2d &pa = v[a].p, &pb = v[b].p;
+        if(pa.y != pb.y) return pa.y > pb.y;
+        if(pa.x != pb.x) return pa.x < pb.x;
+        return a < b;
+    }
+    int Upper(int e) const { return Above(e, v[e].next) ? e : v[e].next; }
+    int Lower(int e) const { return Above(e, v[e].next) ? v[e].next : e; }
+
+    double XAtSweep(int e) const {
+        if(e < 0) return sweep.x;
+        const Point2d &a = v[e].p, &b = v[v[e].next].p;
+        if(a.y == b.y) {
+            return std::min(std::max(sweep.x, std::min(a.x, b.x)),
+                            std::max(a.x, b.x));
+        }
+        if(sweep.y == a.y) return a.x;
+        if(sweep.y == b.y) return b.x;
+        return a.x + (sweep.y - a.y)*(b.x - a.x)/(b.y - a.y);
+    }
+
+    // The order of the edges along the sweep line, from left to right. The
+    // probe -1 stands for the vertex being handled, and an edge through that
+    // vertex sorts to its left.
+    bool EdgeBefore(int a, int b) const {
+        if(a == b) return false;
+        double xa = XAtSweep(a), xb = XAtSweep(b);
+        if(xa != xb) return xa < xb;
+        if(a < 0) return false;
+        if(b < 0) return true;
+        // Two edges that meet on the sweep line, so order them by where they
+        // go below it; a horizontal edge runs right, as if just descending.
+        Point2d da = v[Lower(a)].p.Minus(v[Upper(a)].p),
+                db = v[Lower(b)].p.Minus(v[Upper(b)].p);
+        double l = da.x*(-db.y), r = db.x*(-da.y);
+        if(l != r) return l < r;
+        return a < b;
+    }
+
+    void InsertEdge(int e) {
+        v[e].interiorRight = Above(e, v[e].next);
+        std::pair<EdgeSet::iterator, bool> ins = status.insert(e);
+        if(!ins.second) failed = true;
+        v[e].where = ins.first;
+        v[e].inStatus = true;
+    }
+
+    void RemoveEdge(int e) {
+        if(!v[e].inStatus) {
+            failed = true;
+            return;
+        }
+        status.erase(v[e].where);
+        v[e].inStatus = false;
+    }
+
+    int EdgeLeftOfSweep(void) {
+        EdgeSet::iterator it = status.upper_bound(-1);
+        if(it == status.begin()) return -1;
+        return *(--it);
+    }
+
+    // The edge that bounds the polygon's interior to the left of the vertex
+    // being handled; if there's no such edge, then the input was bad.
+    int InteriorEdgeLeftOfSweep(void) {
+        int e = EdgeLeftOfSweep();
+        if(e < 0 || !v[e].interiorRight) {
+            failed = true;
+            return -1;
+        }
+        return e;
+    }
+
+    // Called on a contour's top vertex, before any of its edges are in the
+    // sweep status. Outer contours get wound counter-clockwise, and holes
+    // clockwise, so that the interior always lies to the left.
+    void OrientContour(int i) {
+        Contour *c = &contours[v[i].contour];
+        c->oriented = true;
+
+        int e = EdgeLeftOfSweep();
+        bool hole = (e >= 0 && v[e].interiorRight);
+        if((c->area < 0) != hole) {
+            for(int j = c->first; j < c->first + c->n; j++) {
+                std::swap(v[j].next, v[j].prev);
+            }
+            c->area = -c->area;
+        }
+    }
+
+    int TypeOf(int i) const {
+        int a = v[i].prev, b = v[i].next;
+        const Point2d &p = v[i].p, &pa = v[a].p, &pb = v[b].p;
+        double cross = (p.x - pa.x)*(pb.y - p.y) - (p.y - pa.y)*(pb.x - p.x);
+        if(Above(i, a) && Above(i, b)) return (cross > 0) ? START : SPLIT;
+        if(Above(a, i) && Above(b, i)) return (cross > 0) ? END : MERGE;
+        return REGULAR;
+    }
+
+    void Diagonal(int a, int b) {
+        if(b < 0 || a == b) {
+            failed = true;
+            return;
+        }
+        v[a].diagonals.push_back(b);
+        v[b].diagonals.push_back(a);
+    }
+
+    // If the helper of edge e is a merge vertex, then connect it to vertex i.
+    void ConnectMergeHelper(int i, int e) {
+        if(e < 0) return;
+        int h = v[e].helper;
+        if(h < 0) {
+            failed = true;
+        } else if(v[h].type == MERGE) {
+            Diagonal(i, h);
+        }
+    }
+
+    void HandleVertex(int i) {
+        sweep = v[i].p;
+        if(!contours[v[i].contour].oriented) OrientContour(i);
+
+        int ep = v[i].prev, en = i, ej;
+        if(Above(ep, i)) RemoveEdge(ep);
+        if(Above(v[i].next, i)) RemoveEdge(en);
+
+        v[i].type = TypeOf(i);
+        switch(v[i].type) {
+            case START:
+                v[en].helper = i;
+                break;
+
+            case END:
+                ConnectMergeHelper(i, ep);
+                break;
+
+            case SPLIT:
+                ej = InteriorEdgeLeftOfSweep();
+                if(ej < 0) break;
+                Diagonal(i, v[ej].helper);
+                v[ej].helper = i;
+                v[en].helper = i;
+                break;
+
+            case MERGE:
+                ConnectMergeHelper(i, ep);
+                ej = InteriorEdgeLeftOfSweep();
+                ConnectMergeHelper(i, ej);
+                if(ej >= 0) v[ej].helper = i;
+                break;
+
+            case REGULAR:
+                if(Above(ep, i)) {
+                    // The interior lies to the right of this vertex.
+                    ConnectMergeHelper(i, ep);
+                    v[en].helper = i;
+                } else {
+                    ej = InteriorEdgeLeftOfSweep();
+                    ConnectMergeHelper(i, ej);
+                    if(ej >= 0) v[ej].helper = i;
+                }
+                break;
+        }
+
+        if(Above(i, ep)) InsertEdge(ep);
+        if(Above(i, v[i].next)) InsertEdge(en);
+    }
+
+    int Target(int i, int slot) const {
+        return (slot < 0) ? v[i].next : v[i].diagonals[slot];
+    }
+    bool Used(int i, int slot) const {
+        return (slot < 0) ? v[i].usedNext : v[i].usedDiagonal[slot];
+    }
+    void SetUsed(int i, int slot) {
+        if(slot < 0) {
+            v[i].usedNext = true;
+        } else {
+            v[i].usedDiagonal[slot] = true;
+        }
+    }
+
+    // Having come from vertex u to w, pick the way out of w that keeps the
+    // same face to our left; that's the first one clockwise from the way
+    // back to u. Compare the directions by cross products, since atan2()
+    // can't resolve the nearly parallel edges that show up in practice.
+    int NextSlot(int u, int w) const {
+        const Point2d &pw = v[w].p;
+        Point2d r = v[u].p.Minus(pw);
+        int best = -1, bestHalf = 3;
+        Point2d bestD = {};
+        for(int slot = -1; slot < (int)v[w].diagonals.size(); slot++) {
+            Point2d d = v[Target(w, slot)].p.Minus(pw);
+            // Which half turn, clockwise from r, the direction d lies in;
+            // and r itself comes last, a full turn round.
+            double cr = r.x*d.y - r.y*d.x, dot = r.Dot(d);
+            int half;
+            if(cr < 0) {
+                half = 0;
+            } else if(cr > 0 || dot < 0) {
+                half = 1;
+            } else {
+                half = 2;
+            }
+            if(half < bestHalf ||
+               (half == bestHalf && half < 2 && bestD.x*d.y - bestD.y*d.x > 0))
+            {
+                best = slot;
+                bestHalf = half;
+                bestD = d;
+            }
+        }
+        return best;
+    }
+
+    void Emit(int a, int b, int c) {
+        const Point2d &pa = v[a].p, &pb = v[b].p, &pc = v[c].p;
+        double area2 = (pb.x - pa.x)*(pc.y - pa.y) - (pb.y - pa.y)*(pc.x - pa.x);
+        triArea += fabs(area2)/2;
+        // A vertex with more than two edges will cause us to generate
+        // zero-area triangles, which must be culled.
+        if(area2 == 0) return;
+        // Anything else is part of the polygon, however thin, and culling it
+        // would leave a gap. But a sliver that's thinner than our tolerance
+        // squared means that the input is degenerate; so give up, and leave
+        // it to the ear clipping.
+        if(fabs(area2) < scaledEps*scaledEps) {
+            failed = true;
+            return;
+        }
+        // Wind them the same way as the ear clipping does.
+        if(area2 > 0) std::swap(b, c);
+
+        STriangle tr = {};
+        tr.a = Vector::From(v[a].p.x, v[a].p.y, 0);
+        tr.b = Vector::From(v[b].p.x, v[b].p.y, 0);
+        tr.c = Vector::From(v[c].p.x, v[c].p.y, 0);
+        out.push_back(tr);
+    }
+
+    // Triangulate one face of the partition, given counter-clockwise. It
+    // should be y-monotone, so it splits at its top and bottom vertices into
+    // a left and right chain, each running downwards.
+    void TriangulateFace(const std::vector<int> &face) {
+        int n = (int)face.size(), top = 0, bottom = 0;
+        if(n < 3) {
+            failed = true;
+            return;
+        }
+        for(int k = 1; k < n; k++) {
+            if(Above(face[k], face[top]))    top = k;
+            if(Above(face[bottom], face[k])) bottom = k;
+        }
+
+        std::vector<int> left, right;
+        for(int k = (top + 1) % n; k != bottom; k = (k + 1) % n) {
+            left.push_back(face[k]);
+        }
+        for(int k = (top + n - 1) % n; k != bottom; k = (k + n - 1) % n) {
+            right.push_back(face[k]);
+        }
+        for(size_t k = 1; k < left.size(); k++) {
+            if(!Above(left[k-1], left[k])) failed = true;
+        }
+        for(size_t k = 1; k < right.size(); k++) {
+            if(!Above(right[k-1], right[k])) failed = true;
+        }
+        if(failed) return;
+
+        // Merge the two chains into one list from top to bottom.
+        std::vector<int> u;
+        std::vector<bool> onLeft;
+        u.push_back(face[top]);
+        onLeft.push_back(true);
+        size_t li = 0, ri = 0;
+        while(li < left.size() || ri < right.size()) {
+            if(ri >= right.size() ||
+               (li < left.size() && Above(left[li], right[ri])))
+            {
+                u.push_back(left[li++]);
+                onLeft.push_back(true);
+            } else {
+                u.push_back(right[ri++]);
+                onLeft.push_back(false);
+            }
+        }
+        u.push_back(face[bottom]);
+        onLeft.push_back(false);
+
+        std::vector<int> stack;
+        stack.push_back(0);
+        stack.push_back(1);
+        for(int j = 2; j < n - 1; j++) {
+            if(onLeft[j] != onLeft[stack.back()]) {
+                // Opposite chains, so the vertex sees everything on the
+                // stack; fan out to all of it.
+                while(stack.size() > 1) {
+                    int a = stack.back();
+                    stack.pop_back();
+                    Emit(u[j], u[a], u[stack.back()]);
+                }
+                stack.clear();
+                stack.push_back(j - 1);
+                stack.push_back(j);
+            } else {
+                // Same chain, so cut off triangles for as long as they lie
+                // inside the face.
+                int last = stack.back();
+                stack.pop_back();
+                while(!stack.empty()) {
+                    const Point2d &pj = v[u[j]].p,
+                                  &pl = v[u[last]].p,
+                                  &pt = v[u[stack.back()]].p;
+                    double cross = (pl.x - pj.x)*(pt.y - pj.y) -
+                                   (pl.y - pj.y)*(pt.x - pj.x);
+                    if(onLeft[j] ? (cross >= 0) : (cross <= 0)) break;
+                    Emit(u[j], u[last], u[stack.back()]);
+                    last = stack.back();
+                    stack.pop_back();
+                }
+                stack.push_back(last);
+                stack.push_back(j);
+            }
+        }
+        while(stack.size() > 1) {
+            int a = stack.back();
+            stack.pop_back();
+            Emit(u[n-1], u[a], u[stack.back()]);
+        }
+    }
+
+    bool Triangulate(void) {
+        std::vector<int> order;
+        for(int i = 0; i < (int)v.size(); i++) order.push_back(i);
+        std::sort(order.begin(), order.end(),
+            [&](int a, int b) { return Above(a, b); });
+
+        for(int i : order) {
+            HandleVertex(i);
+            if(failed) return false;
+        }
+
+        // Now walk around the faces that the diagonals cut the polygon into,
+        // and triangulate each of those.
+        for(Vertex &vt : v) {
+            vt.usedDiagonal.resize(vt.diagonals.size(), false);
+        }
+        std::vector<int> face;
+        for(int i = 0; i < (int)v.size(); i++) {
+            for(int slot = -1; slot < (int)v[i].diagonals.size(); slot++) {
+                if(Used(i, slot)) continue;
+
+                face.clear();
+                int u = i, s = slot;
+                for(;;) {
+                    SetUsed(u, s);
+                    int w = Target(u, s);
+                    face.push_back(w);
+                    int sn = NextSlot(u, w);
+                    if(w == i && sn == slot) break;
+                    if(Used(w, sn) || face.size() > v.size()) return false;
+                    u = w;
+                    s = sn;
+                }
+                TriangulateFace(face);
+                if(failed) return false;
+            }
+        }
+
+        // And if the input was degenerate in some way we didn't catch, then
+        // the triangles won't cover the polygon exactly.
+        double area = 0;
+        for(Contour &c : contours) area += c.area;
+        return fabs(triArea - area) <= 1e-6*fabs(area) + LENGTH_EPS*LENGTH_EPS;
+    }
+};
+
+bool SPolygon::MonotoneTriangulateInto(List<STriangle> *tl, double scaledEps) {
+    MonotoneTriangulator mt(scaledEps);
+    SContour *sc;
+    for(sc = l.First(); sc; sc = l.NextAfter(sc)) {
+        mt.AddContour(sc);
+    }
+    if(!mt.Triangulate()) return false;
+
+    for(STriangle &tr : mt.out) {
+        tl->Add(&tr);
+    }
+    return true;
+}
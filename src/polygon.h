@@ -11,10 +11,55 @@
 class SPointList;
 class SPolygon;
 class SContour;
+class STriangle;
 class SMesh;
 class SBsp3;
 class SOutlineList;
 
+// A hash from points to integer ids (like indices into some list), to find
+// the points that are equal to a given one without a linear search. Points
+// are binned into cells at least twice LENGTH_EPS across, so anything within
+// LENGTH_EPS of a point is in one of the eight cells around it.
+class SPointGrid {
+public:
+    static const double CELL;
+
+    struct Entry {
+        int64_t     x, y, z;
+        int         id;
+        int         next;
+    };
+    std::vector<int>    bucket;
+    std::vector<Entry>  entry;
+
+    void Clear(void);
+    void Add(Vector p, int id);
+
+    static int64_t CellOf(double v) { return (int64_t)floor(v / CELL); }
+    int BucketOf(int64_t x, int64_t y, int64_t z);
+
+    // Calls fn(id) for every id that was added with a point that might be
+    // within LENGTH_EPS of p, in no particular order and possibly more than
+    // once; so the caller must still test for equality.
+    template<class F>
+    void ForEachNear(Vector p, F fn) {
+        if(entry.empty()) return;
+
+        int64_t x, y, z;
+        for(x = CellOf(p.x - LENGTH_EPS); x <= CellOf(p.x + LENGTH_EPS); x++) {
+        for(y = CellOf(p.y - LENGTH_EPS); y <= CellOf(p.y + LENGTH_EPS); y++) {
+        for(z = CellOf(p.z - LENGTH_EPS); z <= CellOf(p.z + LENGTH_EPS); z++) {
+            int i;
+            for(i = bucket[BucketOf(x, y, z)]; i >= 0; i = entry[i].next) {
+                Entry *e = &(entry[i]);
+                if(e->x == x && e->y == y && e->z == z) fn(e->id);
+            }
+        }
+        }
+        }
+    }
+};
+
 class SEdge {
 public:
     int    tag;
@@ -33,7 +78,7 @@ public:
     void AddEdge(Vector a, Vector b, int auxA=0, int auxB=0);
     bool AssemblePolygon(SPolygon *dest, SEdge *errorAt, bool keepDir=false);
     bool AssembleContour(Vector first, Vector last, SContour *dest,
-                            SEdge *errorAt, bool keepDir);
+                            SEdge *errorAt, bool keepDir, SPointGrid *ends);
     int AnyEdgeCrossings(Vector a, Vector b,
         Vector *pi=NULL, SPointList *spl=NULL);
     bool ContainsEdgeFrom(SEdgeList *sel);
@@ -89,8 +134,15 @@ public:
 class SPointList {
 public:
     List<SPoint>    l;
+    // To look up the points in a long list. This gets brought up to date
+    // before each lookup, so points may be appended to l directly; but they
+    // must be removed with RemoveTagged(), so that it gets rebuilt.
+    SPointGrid      grid;
+    enum { MIN_FOR_GRID = 16 };
 
     void Clear(void);
+    void RemoveTagged(void);
+    bool UpdateGrid(void);
     bool ContainsPoint(Vector pt);
     int IndexForPoint(Vector pt);
     void IncrementTagFor(Vector pt);
@@ -146,6 +198,7 @@ public:
     void OffsetInto(SPolygon *dest, double r);
     void UvTriangulateInto(SMesh *m, SSurface *srf);
     void UvGridTriangulateInto(SMesh *m, SSurface *srf);
+    bool MonotoneTriangulateInto(List<STriangle> *tl, double scaledEps);
 };
 
 class STriangle {
@@ -258,6 +311,43 @@ public:
     uint32_t FirstIntersectionWith(Point2d mp);
 };
 
+// The triangles of an SMesh, with the vertices that are equal (to within
+// LENGTH_EPS) merged, and each triangle given as indices into the list of
+// those; so that we can say which triangles share an edge without searching.
+class SIndexedMesh {
+public:
+    struct Triangle {
+        int         v[3];
+        STriMeta    meta;
+    };
+
+    std::vector<Vector>     vertex;
+    std::vector<Triangle>   tri;
+    // The vertex normals of each triangle, like an, bn and cn in STriangle;
+    // or empty, if they weren't asked for.
+    std::vector<Vector>     normal;
+    // Edge k of triangle i, from v[k] to v[(k+1)%3], is half-edge 3*i + k.
+    // Its mate is the one half-edge back the other way between the same
+    // vertices, or -1 if there's none or more than one. Empty until
+    // FindMates() is called.
+    std::vector<int>        mate;
+    SPointGrid              grid;
+
+    void Clear(void);
+    int AddVertex(Vector p);
+    void AddTriangle(STriangle *tr, bool withNormals);
+    void MakeFromMesh(SMesh *m, bool withNormals);
+    void MakeMeshInto(SMesh *m);
+    void FindMates(void);
+
+    int From(int he) { return tri[he/3].v[he%3]; }
+    int To(int he)   { return tri[he/3].v[(he%3 + 1) % 3]; }
+    Vector Normal(int i);
+
+    void MakeCertainEdgesInto(SEdgeList *sel, int how, int auxA=0);
+    void MakeOutlinesInto(SOutlineList *sol);
+};
+
 // A linked list of triangles
 class STriangleLl {
 public:
@@ -326,12 +416,37 @@ public:
                               bool *inter, bool *leaky, int auxA=0);
     void MakeOutlinesInto(SOutlineList *sel);
 
-    void OcclusionTestLine(SEdge orig, SEdgeList *sel, int cnt, bool removeHidden);
-    void SplitLinesAgainstTriangle(SEdgeList *sel, STriangle *tr, bool removeHidden);
-
     void SnapToMesh(SMesh *m);
     void SnapToVertex(Vector v, SMesh *extras);
 };
 
+// A bounding volume hierarchy over the triangles of a mesh that's already
+// been projected for export, so that x and y are on the page and z is
+// towards the viewer. The boxes are in x and y only, and each node also has
+// the nearest z of its triangles; so that hidden line removal finds the few
+// triangles that might hide a given edge, without testing all of them. Only
+// the front-facing triangles can hide anything, so only they are kept.
+class SOcclusionBvh {
+public:
+    struct Node {
+        Point2d max, min;
+        double  zmax;
+        // The children, or for a leaf, -1 and the triangles in [first, last)
+        // of tri.
+        int     left, right;
+        int     first, last;
+    };
+    std::vector<Node>       node;
+    std::vector<STriangle>  tri;
+
+    void Build(SMesh *m);
+    int BuildNode(int first, int last);
+    void Clear(void);
+
+    void OcclusionTestLine(SEdge orig, SEdgeList *sel, bool removeHidden);
+    static void SplitLinesAgainstTriangle(SEdgeList *sel, STriangle *tr,
+                                          bool removeHidden);
+};
+
 #endif
 
@@ -173,6 +173,11 @@ public:
     SMesh           thisMesh;
     SMesh           runningMesh;
 
+    // Fingerprints of the inputs that the shells and meshes above were last
+    // generated from, or zero if they haven't been.
+    uint64_t        thisHash;
+    uint64_t        runningHash;
+
     bool            displayDirty;
     SMesh           displayMesh;
     SEdgeList       displayEdges;
@@ -248,6 +253,7 @@ public:
     Group *PreviousGroup(void);
     Group *RunningMeshGroup(void);
     bool IsMeshGroup();
+    uint64_t HashShellInputs(void);
     void GenerateShellAndMesh(void);
     template<class T> void GenerateForStepAndRepeat(T *steps, T *outs);
     template<class T> void GenerateForBoolean(T *a, T *b, T *o, int how);
@@ -66,6 +66,8 @@ void SolveSpaceUI::Init() {
     drawBackFaces = CnfThawBool(true, "DrawBackFaces");
     // Check that contours are closed and not self-intersecting
     checkClosedContour = CnfThawBool(true, "CheckClosedContour");
+    // Triangulate planar faces by sweep line, instead of ear clipping
+    monotoneTriangulation = CnfThawBool(true, "MonotoneTriangulation");
     // Export shaded triangles in a 2d view
     exportShadedTriangles = CnfThawBool(true, "ExportShadedTriangles");
     // Export pwl curves (instead of exact) always
@@ -98,6 +100,8 @@ void SolveSpaceUI::Init() {
     RefreshRecentMenus();
     // Autosave timer
     autosaveInterval = CnfThawInt(5, "AutosaveInterval");
+    // Threads for the solver and other parallel work
+    workerThreads = CnfThawInt(0, "WorkerThreads");
 
     // The default styles (colors, line widths, etc.) are also stored in the
     // configuration file, but we will automatically load those as we need
@@ -187,6 +191,8 @@ void SolveSpaceUI::Exit(void) {
     CnfFreezeBool(drawBackFaces, "DrawBackFaces");
     // Check that contours are closed and not self-intersecting
     CnfFreezeBool(checkClosedContour, "CheckClosedContour");
+    // Triangulate planar faces by sweep line, instead of ear clipping
+    CnfFreezeBool(monotoneTriangulation, "MonotoneTriangulation");
     // Export shaded triangles in a 2d view
     CnfFreezeBool(exportShadedTriangles, "ExportShadedTriangles");
     // Export pwl curves (instead of exact) always
@@ -214,6 +220,8 @@ void SolveSpaceUI::Exit(void) {
     CnfFreezeBool(showToolbar, "ShowToolbar");
     // Autosave timer
     CnfFreezeInt(autosaveInterval, "AutosaveInterval");
+    // Threads for the solver and other parallel work
+    CnfFreezeInt(workerThreads, "WorkerThreads");
 
     // And the default styles, colors and line widths and such.
     Style::FreezeDefaultStyles();
@@ -280,6 +288,10 @@ int SolveSpaceUI::GetMaxSegments(void) {
     if(exportMode) return exportMaxSegments;
     return maxSegments;
 }
+int SolveSpaceUI::GetWorkerThreads(void) {
+    if(workerThreads <= 0) return CpuCount();
+    return workerThreads;
+}
 int SolveSpaceUI::UnitDigitsAfterDecimal(void) {
     return (viewUnits == UNIT_INCHES) ? afterDecimalInch : afterDecimalMm;
 }
@@ -24,6 +24,7 @@
 #include <unordered_map>
 #include <map>
 #include <set>
+#include <functional>
 #ifdef WIN32
 #   include <windows.h> // required by GL headers
 #endif
@@ -270,6 +271,14 @@ float CnfThawFloat(float val, const std::string &name);
 void *AllocTemporary(size_t n);
 void FreeTemporary(void *p);
 void FreeAllTemporary(void);
+struct TemporaryStats {
+    uint64_t    allocs;     // ever made
+    uint64_t    bytes;      // ever allocated
+    size_t      reserved;   // in chunks that we're holding now
+    size_t      peak;       // the most that we've ever held
+};
+void GetTemporaryStats(TemporaryStats *ts);
+
 void *MemAlloc(size_t n);
 void MemFree(void *p);
 void InitHeaps(void);
@@ -380,11 +389,13 @@ void CnfFreezeBool(bool v, const std::string &name);
 void CnfFreezeColor(RgbaColor v, const std::string &name);
 bool CnfThawBool(bool v, const std::string &name);
 RgbaColor CnfThawColor(RgbaColor v, const std::string &name);
+int CpuCount(void);
+void ParallelFor(int n, int threads, const std::function<void(int)> &fn);
+uint64_t HashMix(uint64_t h, uint64_t v);
+uint64_t HashDouble(uint64_t h, double v);
 
 class System {
 public:
-    enum { MAX_UNKNOWNS = 1024 };
-
     EntityList                      entity;
     ParamList                       param;
     IdList<Equation,hEquation>      eq;
@@ -396,65 +407,129 @@ public:
     enum {
         // In general, the tag indicates the subsys that a variable/equation
         // has been assigned to; these are exceptions for variables:
-        VAR_SUBSTITUTED      = 10000,
-        VAR_DOF_TEST         = 10001,
+        VAR_SUBSTITUTED      = -1,
         // and for equations:
-        EQ_SUBSTITUTED       = 20000
+        EQ_SUBSTITUTED       = -3
     };
 
-    // The system Jacobian matrix
-    struct {
+    // A non-zero entry in a sparse row or column; idx is the column (or
+    // row) that it lives in.
+    struct SparseElem {
+        int     idx;
+        double  val;
+    };
+    typedef std::vector<SparseElem> SparseVector;
+
+    // The Jacobian matrix of a subsystem. Each equation references only a
+    // handful of the unknowns, so this is stored sparse, and its size is
+    // limited only by memory.
+    class Matrix {
+    public:
         // The corresponding equation for each row
-        hEquation   eq[MAX_UNKNOWNS];
+        std::vector<hEquation>  eq;
 
-        // The corresponding parameter for each column
-        hParam      param[MAX_UNKNOWNS];
+        // The corresponding parameter for each column, and a pointer to it
+        // in our param list, so that the numerical solve doesn't need to
+        // look anything up.
+        std::vector<hParam>     param;
+        std::vector<Param *>    paramp;
 
         // We're solving AX = B
         int m, n;
         struct {
-            Expr        *sym[MAX_UNKNOWNS][MAX_UNKNOWNS];
-            double       num[MAX_UNKNOWNS][MAX_UNKNOWNS];
+            // The non-zeros of row i are at [start[i], start[i+1]) in the
+            // other arrays, sorted by column.
+            std::vector<int>     start;
+            std::vector<int>     col;
+            std::vector<double>  num;
         }           A;
 
-        double      scale[MAX_UNKNOWNS];
+        // The weight of each column in the least squares solve
+        std::vector<double>     scale;
 
-        // Some helpers for the least squares solve
-        double AAt[MAX_UNKNOWNS][MAX_UNKNOWNS];
-        double Z[MAX_UNKNOWNS];
+        // Some helpers for the least squares solve; A*A' is factored as
+        // L*D*L', with L unit lower triangular and stored by columns.
+        std::vector<SparseVector>   L;
+        std::vector<double>         D;
+        std::vector<double>         Z;
 
-        double      X[MAX_UNKNOWNS];
+        std::vector<double>     X;
 
         struct {
-            Expr        *sym[MAX_UNKNOWNS];
-            double       num[MAX_UNKNOWNS];
+            std::vector<double>  num;
         }           B;
-    } mat;
+
+        // The equations, compiled with one output per row; and the tape
+        // slot of the param for each column, where its partials appear.
+        ExprTape                tape;
+        std::vector<int>        paramSlot;
+
+        // True if L and D are the factorization of the scaled Jacobian
+        // in A from the last Newton step, so that we could step again.
+        bool                    factoredForStep;
+
+        // These touch only the matrix and the params of its own columns, so
+        // independent subsystems may be solved on different threads.
+        int FactorAAt(double tol);
+        void SolveFactored(std::vector<double> *pz);
+        int CalculateRank(void);
+        bool TestRank(void);
+        bool SolveLeastSquares(void);
+        void FactorForStep(void);
+        void SolveForStep(void);
+        bool TakeStep(void);
+        void EvalResiduals(void);
+        void EvalJacobian(void);
+        bool NewtonSolve(void);
+        bool SolveNearby(void);
+        void MarkFreeParams(void);
+        void Rebind(ParamList *firstTry, ParamList *thenTry);
+    };
+    Matrix                          mat;
+
+    // The subsystems of the system that we're solving, with the single
+    // equations first.
+    std::vector<Matrix>             block;
+    // And those from the last Solve() of each group that succeeded; if the
+    // next system for that group has the same equations (like while the
+    // user drags something), then we can skip straight to the Newton
+    // iterations from the new initial guesses. These are kept by group, so
+    // that solving the groups after the one being dragged doesn't throw
+    // away its subsystems.
+    struct Reuse {
+        uint64_t                hash;
+        int                     alone;
+        int                     dof;
+        std::vector<Matrix>     block;
+        // With the tags that assign them to the subsystems
+        std::vector<Param>      param;
+    };
+    std::unordered_map<uint32_t, Reuse> reuse;
+
+    // How many threads to use for independent subsystems; zero or one to
+    // solve them all on the calling thread.
+    int                             workerThreads;
 
     static const double RANK_MAG_TOLERANCE, CONVERGE_TOLERANCE;
-    int CalculateRank(void);
-    bool TestRank(void);
-    static bool SolveLinearSystem(double X[], double A[][MAX_UNKNOWNS],
-                                  double B[], int N);
-    bool SolveLeastSquares(void);
 
-    bool WriteJacobian(int tag);
-    void EvalJacobian(void);
+    void WriteJacobian(int tag, Matrix *mtx);
 
     void WriteEquationsExceptFor(hConstraint hc, Group *g);
     void FindWhichToRemoveToFixJacobian(Group *g, List<hConstraint> *bad);
     void SolveBySubstitution(void);
+    int TagConnectedComponents(int firstTag);
 
     bool IsDragged(hParam p);
 
-    bool NewtonSolve(int tag);
+    uint64_t HashSystem(void);
+    bool SolveAgain(hGroup hg, uint64_t hash, int *dof);
+    void WriteParamsBack(void);
 
     enum {
         SOLVED_OKAY              = 0,
         DIDNT_CONVERGE           = 10,
         REDUNDANT_OKAY           = 11,
-        REDUNDANT_DIDNT_CONVERGE = 12,
-        TOO_MANY_UNKNOWNS        = 20
+        REDUNDANT_DIDNT_CONVERGE = 12
     };
     int Solve(Group *g, int *dof, List<hConstraint> *bad,
                 bool andFindBad, bool andFindFree);
@@ -481,6 +556,24 @@ public:
     int id;
 };
 
+class MeshFileWriter {
+public:
+    // Output goes through our own buffer, so that a mesh with millions of
+    // triangles doesn't cost a call into stdio for every number.
+    enum { BUFFER_SIZE = 64*1024 };
+
+    FILE                *f;
+    double              scale;
+    std::vector<char>   buf;
+
+    void Write(const void *data, size_t len);
+    void Printf(const char *fmt, ...);
+    void Flush(void);
+
+    void WriteStl(SMesh *sm);
+    void WriteObj(SMesh *sm);
+};
+
 class VectorFileWriter {
 protected:
     Vector u, v, n, origin;
@@ -728,12 +821,14 @@ public:
     bool     fixExportColors;
     bool     drawBackFaces;
     bool     checkClosedContour;
+    bool     monotoneTriangulation;
     bool     showToolbar;
     RgbaColor backgroundColor;
     bool     exportShadedTriangles;
     bool     exportPwlCurves;
     bool     exportCanvasSizeAuto;
     bool     exportMode;
+    bool     headless; // no windows at all, as in the command-line tool
     struct {
         float   left;
         float   right;
@@ -761,6 +856,26 @@ public:
     int      afterDecimalMm;
     int      afterDecimalInch;
     int      autosaveInterval; // in minutes
+    int      workerThreads; // zero for one per core
+    // How much the last regeneration allocated on the temporary heap
+    TemporaryStats regenTemporary;
+    // In the last regeneration's Booleans, the number of surface pairs, the
+    // ones with overlapping bounding boxes that we tried to intersect, and
+    // the ones that actually intersected; and the time that took.
+    struct {
+        uint64_t    pairs;
+        uint64_t    tested;
+        uint64_t    intersected;
+        int64_t     ms;
+    }        regenBoolean;
+    // And how long the last regeneration took in milliseconds to solve, to
+    // do the Booleans (the whole of each, not just the intersections), and
+    // to triangulate shells.
+    struct {
+        int64_t     solve;
+        int64_t     boolean;
+        int64_t     triangulate;
+    }        regenMs;
 
     std::string MmToString(double v);
     double ExprToMm(Expr *e);
@@ -772,6 +887,7 @@ public:
     double ChordTolMm(void);
     double ExportChordTolMm(void);
     int GetMaxSegments(void);
+    int GetWorkerThreads(void);
     bool usePerspectiveProj;
     double CameraTangent(void);
 
@@ -830,8 +946,6 @@ public:
     // And the various export options
     void ExportAsPngTo(const std::string &filename);
     void ExportMeshTo(const std::string &filename);
-    void ExportMeshAsStlTo(FILE *f, SMesh *sm);
-    void ExportMeshAsObjTo(FILE *f, SMesh *sm);
     void ExportMeshAsThreeJsTo(FILE *f, const std::string &filename,
                                SMesh *sm, SEdgeList *sel);
     void ExportViewOrWireframeTo(const std::string &filename, bool wireframe);
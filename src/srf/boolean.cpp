@@ -6,8 +6,6 @@
 //-----------------------------------------------------------------------------
 #include "solvespace.h"
 
-static int I;
-
 void SShell::MakeFromUnionOf(SShell *a, SShell *b) {
     MakeFromBoolean(a, b, AS_UNION);
 }
@@ -22,9 +20,10 @@ void SShell::MakeFromDifferenceOf(SShell *a, SShell *b) {
 // the intersection so that it lies on all three relevant surfaces: the
 // intersecting surface, srfA, and srfB. (So the pwl curve should lie at
 // the intersection of srfA and srfB.) Return a new pwl curve with everything
-// split.
+// split. This gets called from many threads at once, so the line that qsort
+// compares against is per-thread.
 //-----------------------------------------------------------------------------
-static Vector LineStart, LineDirection;
+static thread_local Vector LineStart, LineDirection;
 static int ByTAlongLine(const void *av, const void *bv)
 {
     SInter *a = (SInter *)av,
@@ -130,16 +129,24 @@ SCurve SCurve::MakeCopySplitAgainst(SShell *agnstA, SShell *agnstB,
 }
 
 void SShell::CopyCurvesSplitAgainst(bool opA, SShell *agnst, SShell *into) {
-    SCurve *sc;
-    for(sc = curve.First(); sc; sc = curve.NextAfter(sc)) {
-        SCurve scn = sc->MakeCopySplitAgainst(agnst, NULL,
+    // The curves split independently, so do that in parallel, and then add
+    // them in order so that they get the same ids as if we hadn't.
+    std::vector<SCurve> split(curve.n);
+    SSurface::ForEachInParallel(curve.n, [&](int i) {
+        SCurve *sc = &(curve.elem[i]);
+        split[i] = sc->MakeCopySplitAgainst(agnst, NULL,
                                 surface.FindById(sc->surfA),
                                 surface.FindById(sc->surfB));
-        scn.source = opA ? SCurve::FROM_A : SCurve::FROM_B;
+    });
+
+    int i;
+    for(i = 0; i < curve.n; i++) {
+        SCurve *scn = &(split[i]);
+        scn->source = opA ? SCurve::FROM_A : SCurve::FROM_B;
 
-        hSCurve hsc = into->curve.AddAndAssignId(&scn);
+        hSCurve hsc = into->curve.AddAndAssignId(scn);
         // And note the new ID so that we can rewrite the trims appropriately
-        sc->newH = hsc;
+        curve.elem[i].newH = hsc;
     }
 }
 
@@ -268,7 +275,7 @@ static void TagByClassifiedEdge(int bspclass, int *indir, int *outdir)
     }
 }
 
-static void DEBUGEDGELIST(SEdgeList *sel, SSurface *surf) {
+static void DEBUGEDGELIST(SEdgeList *sel, SSurface *surf, SEdgeList *naked) {
     dbp("print %d edges", sel->l.n);
     SEdge *se;
     for(se = sel->l.First(); se; se = sel->l.NextAfter(se)) {
@@ -279,10 +286,10 @@ static void DEBUGEDGELIST(SEdgeList *sel, SSurface *surf) {
         arrow = arrow.WithMagnitude(0.01);
         arrow = arrow.Plus(mid);
 
-        SS.nakedEdges.AddEdge(surf->PointAt(se->a.x, se->a.y),
-                              surf->PointAt(se->b.x, se->b.y));
-        SS.nakedEdges.AddEdge(surf->PointAt(mid.x, mid.y),
-                              surf->PointAt(arrow.x, arrow.y));
+        naked->AddEdge(surf->PointAt(se->a.x, se->a.y),
+                       surf->PointAt(se->b.x, se->b.y));
+        naked->AddEdge(surf->PointAt(mid.x, mid.y),
+                       surf->PointAt(arrow.x, arrow.y));
     }
 }
 
@@ -406,12 +413,14 @@ void SSurface::EdgeNormalsWithinSurface(Point2d auv, Point2d buv,
 // Trim this surface against the specified shell, in the way that's appropriate
 // for the specified Boolean operation type (and which operand we are). We
 // also need a pointer to the shell that contains our own surface, since that
-// contains our original trim curves.
+// contains our original trim curves. If the new trim curves don't close,
+// then we set failed, and add them to naked (to display for debugging).
 //-----------------------------------------------------------------------------
 SSurface SSurface::MakeCopyTrimAgainst(SShell *parent,
                                        SShell *sha, SShell *shb,
                                        SShell *into,
-                                       int type)
+                                       int type,
+                                       bool *failed, SEdgeList *naked)
 {
     bool opA = (parent == sha);
     SShell *agnst = opA ? shb : sha;
@@ -515,7 +524,7 @@ SSurface SSurface::MakeCopyTrimAgainst(SShell *parent,
             sp->tag = 0;
         }
     }
-    choosing.l.RemoveTagged();
+    choosing.RemoveTagged();
 
     // The list of edges to trim our new surface, a combination of edges from
     // our original and intersecting edge lists.
@@ -600,9 +609,9 @@ SSurface SSurface::MakeCopyTrimAgainst(SShell *parent,
     SPolygon poly = {};
     final.l.ClearTags();
     if(!final.AssemblePolygon(&poly, NULL, true)) {
-        into->booleanFailed = true;
-        dbp("failed: I=%d, avoid=%d", I, choosing.l.n);
-        DEBUGEDGELIST(&final, &ret);
+        *failed = true;
+        dbp("failed: srf=%d, avoid=%d", h.v, choosing.l.n);
+        DEBUGEDGELIST(&final, &ret, naked);
     }
     poly.Clear();
 
@@ -616,26 +625,72 @@ SSurface SSurface::MakeCopyTrimAgainst(SShell *parent,
 void SShell::CopySurfacesTrimAgainst(SShell *sha, SShell *shb, SShell *into,
                                         int type)
 {
-    SSurface *ss;
-    for(ss = surface.First(); ss; ss = surface.NextAfter(ss)) {
-        SSurface ssn;
-        ssn = ss->MakeCopyTrimAgainst(this, sha, shb, into, type);
-        ss->newH = into->surface.AddAndAssignId(&ssn);
-        I++;
+    // Each surface gets trimmed independently, against the curves that are
+    // all in into by now; so do that in parallel, and add them in order.
+    std::vector<SSurface> trimmed(surface.n);
+    std::vector<SEdgeList> naked(surface.n);
+    std::vector<char> failed(surface.n);
+    SSurface::ForEachInParallel(surface.n, [&](int i) {
+        bool f = false;
+        naked[i] = {};
+        trimmed[i] = surface.elem[i].MakeCopyTrimAgainst(this, sha, shb, into,
+                                                         type, &f, &naked[i]);
+        failed[i] = f;
+    });
+
+    int i;
+    for(i = 0; i < surface.n; i++) {
+        surface.elem[i].newH = into->surface.AddAndAssignId(&(trimmed[i]));
+        if(failed[i]) into->booleanFailed = true;
+
+        SEdge *se;
+        for(se = naked[i].l.First(); se; se = naked[i].l.NextAfter(se)) {
+            SS.nakedEdges.AddEdge(se->a, se->b);
+        }
+        naked[i].Clear();
     }
 }
 
 void SShell::MakeIntersectionCurvesAgainst(SShell *agnst, SShell *into) {
-    SSurface *sa;
-    for(sa = surface.First(); sa; sa = surface.NextAfter(sa)) {
-        SSurface *sb;
-        for(sb = agnst->surface.First(); sb; sb = agnst->surface.NextAfter(sb)){
-            // Intersect every surface from our shell against every surface
-            // from agnst; this will add zero or more curves to the curve
-            // list for into.
-            sa->IntersectAgainst(sb, this, agnst, into);
+    int64_t inTime = GetMilliseconds();
+
+    // Surfaces can intersect only if their bounding boxes do, so use a BVH
+    // to find those pairs, instead of trying every pair.
+    SSurfaceBvh *bvh = agnst->GetSurfaceBvh();
+
+    // Intersect each of our surfaces against agnst in parallel, with the
+    // new curves for each surface kept apart until they're all done.
+    std::vector<std::vector<SCurveCandidate>> cands(surface.n);
+    std::vector<int> tested(surface.n);
+    SSurface::ForEachInParallel(surface.n, [&](int j) {
+        SSurface *sa = &(surface.elem[j]);
+        Vector amax, amin;
+        sa->GetAxisAlignedBounding(&amax, &amin);
+        std::vector<int> found;
+        bvh->FindOverlapping(amax, amin, &found);
+        // Keep the same order as if we tried them all, so that the curves
+        // get the same ids.
+        std::sort(found.begin(), found.end());
+        for(int i : found) {
+            // Intersect the surface from our shell against the surface from
+            // agnst; this will generate zero or more curves.
+            sa->IntersectAgainst(&(agnst->surface.elem[i]), this, agnst, into,
+                                 &(cands[j]));
         }
+        tested[j] = (int)found.size();
+    });
+
+    // And add those curves to into, in the same order as if we'd done it
+    // all on one thread.
+    int firstNew = into->curve.n;
+    int j;
+    for(j = 0; j < surface.n; j++) {
+        into->AddIntersectionCurves(&(surface.elem[j]), agnst, firstNew,
+                                    &(cands[j]), &SS.regenBoolean.intersected);
+        SS.regenBoolean.tested += tested[j];
     }
+    SS.regenBoolean.pairs += (uint64_t)surface.n * agnst->surface.n;
+    SS.regenBoolean.ms += GetMilliseconds() - inTime;
 }
 
 void SShell::CleanupAfterBoolean(void) {
@@ -710,6 +765,7 @@ void SShell::MakeFromAssemblyOf(SShell *a, SShell *b) {
 
 void SShell::MakeFromBoolean(SShell *a, SShell *b, int type) {
     booleanFailed = false;
+    SSurface::ForgetClosestPoints();
 
     a->MakeClassifyingBsps(NULL);
     b->MakeClassifyingBsps(NULL);
@@ -740,11 +796,6 @@ void SShell::MakeFromBoolean(SShell *a, SShell *b, int type) {
     a->MakeClassifyingBsps(this);
     b->MakeClassifyingBsps(this);
 
-    if(b->surface.n == 0 || a->surface.n == 0) {
-        I = 1000000;
-    } else {
-        I = 0;
-    }
     // Then trim and copy the surfaces
     a->CopySurfacesTrimAgainst(a, b, this, type);
     b->CopySurfacesTrimAgainst(a, b, this, type);
@@ -763,10 +814,14 @@ void SShell::MakeFromBoolean(SShell *a, SShell *b, int type) {
 // All of the BSP routines that we use to perform and accelerate polygon ops.
 //-----------------------------------------------------------------------------
 void SShell::MakeClassifyingBsps(SShell *useCurvesFrom) {
-    SSurface *ss;
-    for(ss = surface.First(); ss; ss = surface.NextAfter(ss)) {
-        ss->MakeClassifyingBsp(this, useCurvesFrom);
-    }
+    // We're about to ray cast against this shell from the worker threads, so
+    // get its BVH ready now; and rebuild it, in case a surface changed in
+    // place.
+    bvh.Build(this);
+
+    SSurface::ForEachInParallel(surface.n, [&](int i) {
+        surface.elem[i].MakeClassifyingBsp(this, useCurvesFrom);
+    });
 }
 
 void SSurface::MakeClassifyingBsp(SShell *shell, SShell *useCurvesFrom) {
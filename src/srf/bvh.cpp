@@ -0,0 +1,187 @@
+//-----------------------------------------------------------------------------
+// A bounding volume hierarchy over the surfaces of a shell, built from their
+// axis-aligned bounding boxes, to quickly find the surfaces that might
+// intersect something.
+//-----------------------------------------------------------------------------
+#include "../solvespace.h"
+
+void SSurfaceBvh::Build(SShell *shell) {
+    int i, n = shell->surface.n;
+
+    srfMax.resize(n);
+    srfMin.resize(n);
+    order.resize(n);
+    for(i = 0; i < n; i++) {
+        shell->surface.elem[i].GetAxisAlignedBounding(&srfMax[i], &srfMin[i]);
+        order[i] = i;
+    }
+
+    node.clear();
+    if(n > 0) BuildNode(0, n);
+
+    builtFrom       = shell->surface.elem;
+    builtGeneration = shell->surface.generation;
+}
+
+//-----------------------------------------------------------------------------
+// Is this still good for that shell? The list's generation tells us if
+// surfaces have been added or removed, but not if one has been modified in
+// place, so anything that does that must call Clear().
+//-----------------------------------------------------------------------------
+bool SSurfaceBvh::IsBuiltFrom(SShell *shell) {
+    return (builtFrom != NULL &&
+            builtFrom == shell->surface.elem &&
+            builtGeneration == shell->surface.generation);
+}
+
+//-----------------------------------------------------------------------------
+// The BVH over this shell's surfaces, rebuilt if they've changed. Rebuilding
+// isn't thread-safe, so anything that queries the shell from many threads at
+// once must make sure it's up to date first (as MakeClassifyingBsps() does).
+//-----------------------------------------------------------------------------
+SSurfaceBvh *SShell::GetSurfaceBvh(void) {
+    if(!bvh.IsBuiltFrom(this)) bvh.Build(this);
+    return &bvh;
+}
+
+void SSurfaceBvh::Clear(void) {
+    node.clear();
+    order.clear();
+    srfMax.clear();
+    srfMin.clear();
+    builtFrom = NULL;
+    builtGeneration = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Make a node for the surfaces in [first, last) of order, splitting them at
+// the median along the axis in which their centers are most spread out.
+// Returns the index of the new node.
+//-----------------------------------------------------------------------------
+int SSurfaceBvh::BuildNode(int first, int last) {
+    static const int LEAF_SIZE = 4;
+    int i;
+
+    Vector max = Vector::From(VERY_NEGATIVE, VERY_NEGATIVE, VERY_NEGATIVE),
+           min = Vector::From(VERY_POSITIVE, VERY_POSITIVE, VERY_POSITIVE),
+           cmax = max, cmin = min;
+    for(i = first; i < last; i++) {
+        int s = order[i];
+        srfMax[s].MakeMaxMin(&max, &min);
+        srfMin[s].MakeMaxMin(&max, &min);
+        Vector c = (srfMax[s].Plus(srfMin[s])).ScaledBy(0.5);
+        c.MakeMaxMin(&cmax, &cmin);
+    }
+
+    int r = (int)node.size();
+    node.push_back({ max, min, -1, -1, first, last });
+    if(last - first <= LEAF_SIZE) return r;
+
+    Vector spread = cmax.Minus(cmin);
+    int axis = 0;
+    if(spread.y > spread.Element(axis)) axis = 1;
+    if(spread.z > spread.Element(axis)) axis = 2;
+
+    int mid = (first + last)/2;
+    std::nth_element(order.begin() + first, order.begin() + mid,
+                     order.begin() + last, [&](int a, int b) {
+        return srfMax[a].Element(axis) + srfMin[a].Element(axis) <
+               srfMax[b].Element(axis) + srfMin[b].Element(axis);
+    });
+
+    int left  = BuildNode(first, mid);
+    int right = BuildNode(mid, last);
+    node[r].left  = left;
+    node[r].right = right;
+    return r;
+}
+
+//-----------------------------------------------------------------------------
+// Find all the surfaces whose bounding boxes aren't disjoint from the given
+// box, with the same tolerance as Vector::BoundingBoxesDisjoint(). They're
+// returned in no particular order.
+//-----------------------------------------------------------------------------
+void SSurfaceBvh::FindOverlapping(Vector max, Vector min,
+                                  std::vector<int> *found)
+{
+    found->clear();
+    if(node.empty()) return;
+
+    int stack[64], depth = 0;
+    stack[depth++] = 0;
+    while(depth > 0) {
+        Node *nd = &node[stack[--depth]];
+        if(Vector::BoundingBoxesDisjoint(nd->max, nd->min, max, min)) continue;
+
+        if(nd->left < 0) {
+            for(int i = nd->first; i < nd->last; i++) {
+                int s = order[i];
+                if(Vector::BoundingBoxesDisjoint(srfMax[s], srfMin[s],
+                                                 max, min)) continue;
+                found->push_back(s);
+            }
+        } else {
+            stack[depth++] = nd->left;
+            stack[depth++] = nd->right;
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Could the line through a and b (or just the segment from a to b, if seg)
+// pass through the given box? This is conservative: the box gets grown by
+// a few LENGTH_EPS, so that it's true whenever SSurface::
+// LineEntirelyOutsideBbox() would be false.
+//-----------------------------------------------------------------------------
+static bool LineMightCrossBox(Vector a, Vector b, bool seg,
+                              Vector boxMax, Vector boxMin)
+{
+    double tol = 10*LENGTH_EPS;
+    double t0 = seg ? 0 : VERY_NEGATIVE,
+           t1 = seg ? 1 : VERY_POSITIVE;
+    for(int i = 0; i < 3; i++) {
+        double ai = a.Element(i), d = b.Element(i) - ai,
+               lo = boxMin.Element(i) - tol, hi = boxMax.Element(i) + tol;
+        if(d == 0) {
+            if(ai < lo || ai > hi) return false;
+            continue;
+        }
+        double tlo = (lo - ai)/d, thi = (hi - ai)/d;
+        if(tlo > thi) swap(tlo, thi);
+        t0 = max(t0, tlo);
+        t1 = min(t1, thi);
+        if(t0 > t1) return false;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Find all the surfaces whose bounding boxes the line through a and b (or
+// just the segment, if seg) might pass through. They're returned in order,
+// so that callers see the surfaces in the same order as in the shell.
+//-----------------------------------------------------------------------------
+void SSurfaceBvh::FindCrossedBy(Vector a, Vector b, bool seg,
+                                std::vector<int> *found)
+{
+    found->clear();
+    if(node.empty()) return;
+
+    int stack[64], depth = 0;
+    stack[depth++] = 0;
+    while(depth > 0) {
+        Node *nd = &node[stack[--depth]];
+        if(!LineMightCrossBox(a, b, seg, nd->max, nd->min)) continue;
+
+        if(nd->left < 0) {
+            for(int i = nd->first; i < nd->last; i++) {
+                int s = order[i];
+                if(!LineMightCrossBox(a, b, seg, srfMax[s], srfMin[s])) continue;
+                found->push_back(s);
+            }
+        } else {
+            stack[depth++] = nd->left;
+            stack[depth++] = nd->right;
+        }
+    }
+    std::sort(found->begin(), found->end());
+}
@@ -381,48 +381,38 @@ bool SBezierList::GetPlaneContainingBeziers(Vector *p, Vector *u, Vector *v,
 }
 
 //-----------------------------------------------------------------------------
-// Assemble curves in sbl into a single loop. The curves may appear in any
-// direction (start to finish, or finish to start), and will be reversed if
-// necessary. The curves in the returned loop are removed from sbl, even if
-// the loop cannot be closed.
+// Chain curves into a loop, starting from the curve with the given index.
+// The next curve is always the first untagged one in the list that continues
+// from where the loop is hanging, reversed if necessary; ends holds the
+// endpoints of every curve, so we can find that without searching the whole
+// list. Each curve that gets used is tagged.
 //-----------------------------------------------------------------------------
-SBezierLoop SBezierLoop::FromCurves(SBezierList *sbl,
-                                    bool *allClosed, SEdge *errorAt)
+SBezierLoop SBezierLoop::FromCurves(SBezierList *sbl, SPointGrid *ends,
+                                    int first, bool *allClosed, SEdge *errorAt)
 {
     SBezierLoop loop = {};
 
-    if(sbl->l.n < 1) return loop;
-    sbl->l.ClearTags();
-
-    SBezier *first = &(sbl->l.elem[0]);
-    first->tag = 1;
-    loop.l.Add(first);
-    Vector start = first->Start();
-    Vector hanging = first->Finish();
-    int auxA = first->auxA;
+    SBezier *sbf = &(sbl->l.elem[first]);
+    sbf->tag = 1;
+    loop.l.Add(sbf);
+    Vector start = sbf->Start();
+    Vector hanging = sbf->Finish();
+    int auxA = sbf->auxA;
 
-    sbl->l.RemoveTagged();
+    while(!hanging.Equals(start)) {
+        int next = -1;
+        ends->ForEachNear(hanging, [&](int i) {
+            if(next >= 0 && i >= next) return;
 
-    while(sbl->l.n > 0 && !hanging.Equals(start)) {
-        int i;
-        bool foundNext = false;
-        for(i = 0; i < sbl->l.n; i++) {
             SBezier *test = &(sbl->l.elem[i]);
-
-            if((test->Finish()).Equals(hanging) && test->auxA == auxA) {
-                test->Reverse();
-                // and let the next test catch it
-            }
-            if((test->Start()).Equals(hanging) && test->auxA == auxA) {
-                test->tag = 1;
-                loop.l.Add(test);
-                hanging = test->Finish();
-                sbl->l.RemoveTagged();
-                foundNext = true;
-                break;
+            if(test->tag || test->auxA != auxA) return;
+            if((test->Start()).Equals(hanging) ||
+               (test->Finish()).Equals(hanging))
+            {
+                next = i;
             }
-        }
-        if(!foundNext) {
+        });
+        if(next < 0) {
             // The loop completed without finding the hanging edge, so
             // it's an open loop
             errorAt->a = hanging;
@@ -430,15 +420,16 @@ SBezierLoop SBezierLoop::FromCurves(SBezierList *sbl,
             *allClosed = false;
             return loop;
         }
+
+        SBezier *test = &(sbl->l.elem[next]);
+        if((test->Finish()).Equals(hanging)) {
+            test->Reverse();
+        }
+        test->tag = 1;
+        loop.l.Add(test);
+        hanging = test->Finish();
     }
-    if(hanging.Equals(start)) {
-        *allClosed = true;
-    } else {
-        // We ran out of edges without forming a closed loop.
-        errorAt->a = hanging;
-        errorAt->b = start;
-        *allClosed = false;
-    }
+    *allClosed = true;
 
     return loop;
 }
@@ -499,11 +490,21 @@ SBezierLoopSet SBezierLoopSet::From(SBezierList *sbl, SPolygon *poly,
 {
     SBezierLoopSet ret = {};
 
+    sbl->l.ClearTags();
+    SPointGrid ends = {};
+    int i;
+    for(i = 0; i < sbl->l.n; i++) {
+        ends.Add(sbl->l.elem[i].Start(), i);
+        ends.Add(sbl->l.elem[i].Finish(), i);
+    }
+
     *allClosed = true;
-    while(sbl->l.n > 0) {
+    for(i = 0; i < sbl->l.n; i++) {
+        if(sbl->l.elem[i].tag) continue;
+
         bool thisClosed;
         SBezierLoop loop;
-        loop = SBezierLoop::FromCurves(sbl, &thisClosed, errorAt);
+        loop = SBezierLoop::FromCurves(sbl, &ends, i, &thisClosed, errorAt);
         if(!thisClosed) {
             // Record open loops in a separate list, if requested.
             *allClosed = false;
@@ -520,6 +521,8 @@ SBezierLoopSet SBezierLoopSet::From(SBezierList *sbl, SPolygon *poly,
             loop.MakePwlInto(&(poly->l.elem[poly->l.n-1]), chordTol);
         }
     }
+    // All the curves got used in some loop, open or closed.
+    sbl->l.RemoveTagged();
 
     poly->normal = poly->ComputeNormal();
     ret.normal = poly->normal;
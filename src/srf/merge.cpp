@@ -6,12 +6,45 @@
 //-----------------------------------------------------------------------------
 #include "../solvespace.h"
 
+// Planes get binned by their unit normal and their distance from the origin,
+// in cells big enough that coincident planes always land in the same or in
+// adjacent cells.
+static const double NORMAL_CELL = 0.01, OFFSET_CELL = 0.1;
+
+static void PlaneCellOf(SSurface *ss, int64_t *cell) {
+    Vector n = ss->NormalAt(0, 0).WithMagnitude(1);
+    double d = n.Dot(ss->ctrl[0][0]);
+    cell[0] = (int64_t)floor(n.x / NORMAL_CELL);
+    cell[1] = (int64_t)floor(n.y / NORMAL_CELL);
+    cell[2] = (int64_t)floor(n.z / NORMAL_CELL);
+    cell[3] = (int64_t)floor(d / OFFSET_CELL);
+}
+
+static uint64_t PlaneKey(const int64_t *cell) {
+    uint64_t h = 0;
+    int i;
+    for(i = 0; i < 4; i++) h = HashMix(h, (uint64_t)cell[i]);
+    return h;
+}
+
 void SShell::MergeCoincidentSurfaces(void) {
     surface.ClearTags();
 
     int i, j;
     SSurface *si, *sj;
 
+    // Only planes can be coincident, and only with planes in the same or
+    // adjacent cells; so bin them, to avoid testing every pair.
+    std::unordered_map<uint64_t, std::vector<int>> planes;
+    int64_t cell[4];
+    for(j = 0; j < surface.n; j++) {
+        sj = &(surface.elem[j]);
+        if(sj->degm != 1 || sj->degn != 1) continue;
+        PlaneCellOf(sj, cell);
+        planes[PlaneKey(cell)].push_back(j);
+    }
+
+    std::vector<int> nearby;
     for(i = 0; i < surface.n; i++) {
         si = &(surface.elem[i]);
         if(si->tag) continue;
@@ -22,6 +55,29 @@ void SShell::MergeCoincidentSurfaces(void) {
         // time on other surfaces.
         if(si->degm != 1 || si->degn != 1) continue;
 
+        // Find the later planes in the cells around ours, in order.
+        nearby.clear();
+        int64_t ci[4];
+        PlaneCellOf(si, ci);
+        int k;
+        for(k = 0; k < 81; k++) {
+            int kk = k;
+            int a;
+            for(a = 0; a < 4; a++) {
+                cell[a] = ci[a] + (kk % 3) - 1;
+                kk /= 3;
+            }
+            auto it = planes.find(PlaneKey(cell));
+            if(it == planes.end()) continue;
+            for(int pj : it->second) {
+                if(pj > i) nearby.push_back(pj);
+            }
+        }
+        // Distinct cells could share a key, so we might have duplicates.
+        std::sort(nearby.begin(), nearby.end());
+        nearby.erase(std::unique(nearby.begin(), nearby.end()), nearby.end());
+        if(nearby.empty()) continue;
+
         SEdgeList sel = {};
         si->MakeEdgesInto(this, &sel, SSurface::AS_XYZ);
 
@@ -29,8 +85,8 @@ void SShell::MergeCoincidentSurfaces(void) {
         do {
             mergedThisTime = false;
 
-            for(j = i + 1; j < surface.n; j++) {
-                sj = &(surface.elem[j]);
+            for(k = 0; k < (int)nearby.size(); k++) {
+                sj = &(surface.elem[nearby[k]]);
                 if(sj->tag) continue;
                 if(!sj->CoincidentWith(si, true)) continue;
                 if(!sj->color.Equals(si->color)) continue;
@@ -123,5 +179,7 @@ void SShell::MergeCoincidentSurfaces(void) {
     }
 
     surface.RemoveTagged();
+    // We moved the corners of the merged planes.
+    bvh.Clear();
 }
 
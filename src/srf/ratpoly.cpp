@@ -386,6 +386,55 @@ Vector SSurface::NormalAt(double u, double v) {
     return tu.Cross(tv);
 }
 
+//-----------------------------------------------------------------------------
+// The last (u, v) that we projected to on the last few surfaces, which makes
+// a good initial guess for the next one. The answer can depend on that guess,
+// so it depends on the order of the calls; so these are per-thread, and work
+// that's split between threads should forget them before each piece, to get
+// the same answer however it's split. The callers mostly go back and forth
+// between one or two surfaces, so we keep only a few, and replace them in
+// turn; that way we never keep a surface that's gone for long, and finding
+// one is just a few compares.
+//-----------------------------------------------------------------------------
+static const int CLOSEST_POINT_GUESSES = 4;
+static thread_local struct {
+    const SSurface  *srf;
+    Point2d         uv;
+} ClosestPointGuess[CLOSEST_POINT_GUESSES];
+static thread_local int NextClosestPointGuess;
+
+static Point2d *ClosestPointGuessFor(const SSurface *srf) {
+    for(auto &g : ClosestPointGuess) {
+        if(g.srf == srf) return &g.uv;
+    }
+    auto &g = ClosestPointGuess[NextClosestPointGuess];
+    NextClosestPointGuess = (NextClosestPointGuess + 1) % CLOSEST_POINT_GUESSES;
+    g.srf = srf;
+    g.uv  = Point2d::From(0, 0);
+    return &g.uv;
+}
+
+void SSurface::ForgetClosestPoints(void) {
+    for(auto &g : ClosestPointGuess) {
+        g.srf = NULL;
+    }
+    NextClosestPointGuess = 0;
+}
+
+//-----------------------------------------------------------------------------
+// Call fn(i) for each i in [0, n), on the worker threads. The closest points
+// that we find on a surface depend on the previous guesses on this thread,
+// so forget those before each call and after them all, to get the same
+// result whichever thread does what.
+//-----------------------------------------------------------------------------
+void SSurface::ForEachInParallel(int n, const std::function<void(int)> &fn) {
+    ParallelFor(n, SS.GetWorkerThreads(), [&](int i) {
+        ForgetClosestPoints();
+        fn(i);
+    });
+    ForgetClosestPoints();
+}
+
 void SSurface::ClosestPointTo(Vector p, Point2d *puv, bool converge) {
     ClosestPointTo(p, &(puv->x), &(puv->y), converge);
 }
@@ -416,11 +465,12 @@ void SSurface::ClosestPointTo(Vector p, double *u, double *v, bool converge) {
     // good if we're working our way along a curve or something else where
     // we project successive points that are close to each other; something
     // like a 20% speedup empirically.
+    Point2d *cached = ClosestPointGuessFor(this);
     if(converge) {
-        double ut = cached.x, vt = cached.y;
+        double ut = cached->x, vt = cached->y;
         if(ClosestPointNewton(p, &ut, &vt, converge)) {
-            cached.x = *u = ut;
-            cached.y = *v = vt;
+            cached->x = *u = ut;
+            cached->y = *v = vt;
             return;
         }
     }
@@ -444,8 +494,8 @@ void SSurface::ClosestPointTo(Vector p, double *u, double *v, bool converge) {
     }
 
     if(ClosestPointNewton(p, u, v, converge)) {
-        cached.x = *u;
-        cached.y = *v;
+        cached->x = *u;
+        cached->y = *v;
         return;
     }
 
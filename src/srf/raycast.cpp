@@ -7,6 +7,7 @@
 //
 // Copyright 2008-2013 Jonathan Westhues.
 //-----------------------------------------------------------------------------
+#include <mutex>
 #include "solvespace.h"
 
 // Dot product tolerance for perpendicular; this is on the direction cosine,
@@ -383,9 +384,13 @@ void SShell::AllPointsIntersecting(Vector a, Vector b,
                                    List<SInter> *il,
                                    bool seg, bool trimmed, bool inclTangent)
 {
-    SSurface *ss;
-    for(ss = surface.First(); ss; ss = surface.NextAfter(ss)) {
-        ss->AllPointsIntersecting(a, b, il, seg, trimmed, inclTangent);
+    // Only the surfaces whose bounding boxes the line crosses can intersect
+    // it; they're found in order, so the intersections are too.
+    std::vector<int> found;
+    GetSurfaceBvh()->FindCrossedBy(a, b, seg, &found);
+    for(int i : found) {
+        surface.elem[i].AllPointsIntersecting(a, b, il, seg, trimmed,
+                                              inclTangent);
     }
 }
 
@@ -411,6 +416,27 @@ int SShell::ClassifyRegion(Vector edge_n, Vector inter_surf_n,
     }
 }
 
+//-----------------------------------------------------------------------------
+// The direction of the n-th ray that we try when classifying an edge by
+// raycasting. These are pseudo-random, but always the same sequence; and
+// we're called from many threads at once, so we can't just reseed rand()
+// each time, so make them all once.
+//-----------------------------------------------------------------------------
+static Vector RayDirection(int n) {
+    static const int RAYS = 8;
+    static const std::vector<Vector> Rays = [] {
+        std::vector<Vector> rays;
+        srand(0);
+        for(int i = 0; i < RAYS; i++) {
+            rays.push_back(Vector::From(Random(1), Random(1), Random(1)));
+        }
+        return rays;
+    }();
+    return Rays[n % RAYS];
+}
+
+static std::mutex NakedEdgesMutex;
+
 //-----------------------------------------------------------------------------
 // Does the given point lie on our shell? There are many cases; inside and
 // outside are obvious, but then there's all the edge-on-edge and edge-on-face
@@ -427,13 +453,16 @@ bool SShell::ClassifyEdge(int *indir, int *outdir,
 {
     List<SInter> l = {};
 
-    srand(0);
+    // The only surfaces that the edge could lie on or touch
+    std::vector<int> nearby;
+    GetSurfaceBvh()->FindCrossedBy(ea, eb, true, &nearby);
 
     // First, check for edge-on-edge
     int edge_inters = 0;
     Vector inter_surf_n[2], inter_edge_n[2];
     SSurface *srf;
-    for(srf = surface.First(); srf; srf = surface.NextAfter(srf)) {
+    for(int i : nearby) {
+        srf = &(surface.elem[i]);
         if(srf->LineEntirelyOutsideBbox(ea, eb, true)) continue;
 
         SEdgeList *sel = &(srf->edges);
@@ -518,7 +547,8 @@ bool SShell::ClassifyEdge(int *indir, int *outdir,
     // are on surface) and for numerical stability, so we don't pick up
     // the additional error from the line intersection.
 
-    for(srf = surface.First(); srf; srf = surface.NextAfter(srf)) {
+    for(int i : nearby) {
+        srf = &(surface.elem[i]);
         if(srf->LineEntirelyOutsideBbox(ea, eb, true)) continue;
 
         Point2d puv;
@@ -550,7 +580,7 @@ bool SShell::ClassifyEdge(int *indir, int *outdir,
         // Cast a ray in a random direction (two-sided so that we test if
         // the point lies on a surface, but use only one side for in/out
         // testing)
-        Vector ray = Vector::From(Random(1), Random(1), Random(1));
+        Vector ray = RayDirection(cnt);
 
         AllPointsIntersecting(
             p.Minus(ray), p.Plus(ray), &l, false, true, false);
@@ -601,6 +631,7 @@ bool SShell::ClassifyEdge(int *indir, int *outdir,
         if(cnt++ > 5) {
             dbp("can't find a ray that doesn't hit on edge!");
             dbp("on edge = %d, edge_inters = %d", onEdge, edge_inters);
+            std::lock_guard<std::mutex> lock(NakedEdgesMutex);
             SS.nakedEdges.AddEdge(ea, eb);
             break;
         }
@@ -808,7 +808,8 @@ void SShell::MakeFromRevolutionOf(SBezierLoopSet *sbls, Vector pt, Vector axis,
         }
 
     }
-
+    // We rewrote some of those surfaces in place.
+    bvh.Clear();
 }
 
 void SShell::MakeFromCopyOf(SShell *a) {
@@ -854,23 +855,48 @@ void SShell::MakeSectionEdgesInto(Vector n, double d,
     }
 }
 
+//-----------------------------------------------------------------------------
+// The surfaces triangulate independently, so do that in parallel, each into
+// its own mesh, and then append those in order; so we get the same mesh
+// however many threads we use.
+//-----------------------------------------------------------------------------
 void SShell::TriangulateInto(SMesh *sm) {
-    SSurface *s;
-    for(s = surface.First(); s; s = surface.NextAfter(s)) {
-        s->TriangulateInto(this, sm);
+    int64_t inTime = GetMilliseconds();
+    std::vector<SMesh> meshes(surface.n);
+    SSurface::ForEachInParallel(surface.n, [&](int i) {
+        surface.elem[i].TriangulateInto(this, &(meshes[i]));
+    });
+
+    for(SMesh &m : meshes) {
+        sm->MakeFromCopyOf(&m);
+        m.Clear();
     }
+    SS.regenMs.triangulate += GetMilliseconds() - inTime;
 }
 
 bool SShell::IsEmpty(void) {
     return (surface.n == 0);
 }
 
+void SShell::GetBounding(Vector *vmax, Vector *vmin) {
+    *vmin = Vector::From( 1e12,  1e12,  1e12);
+    *vmax = Vector::From(-1e12, -1e12, -1e12);
+    SSurface *ss;
+    for(ss = surface.First(); ss; ss = surface.NextAfter(ss)) {
+        Vector smax, smin;
+        ss->GetAxisAlignedBounding(&smax, &smin);
+        smax.MakeMaxMin(vmax, vmin);
+        smin.MakeMaxMin(vmax, vmin);
+    }
+}
+
 void SShell::Clear(void) {
     SSurface *s;
     for(s = surface.First(); s; s = surface.NextAfter(s)) {
         s->Clear();
     }
     surface.Clear();
+    bvh.Clear();
 
     SCurve *c;
     for(c = curve.First(); c; c = curve.NextAfter(c)) {
@@ -140,8 +140,8 @@ public:
     void MakePwlInto(SContour *sc, double chordTol=0);
     void GetBoundingProjd(Vector u, Vector orig, double *umin, double *umax);
 
-    static SBezierLoop FromCurves(SBezierList *spcl,
-                                  bool *allClosed, SEdge *errorAt);
+    static SBezierLoop FromCurves(SBezierList *spcl, SPointGrid *ends,
+                                  int first, bool *allClosed, SEdge *errorAt);
 };
 
 class SBezierLoopSet {
@@ -215,6 +215,18 @@ public:
     void Clear(void);
 };
 
+// An intersection curve between two surfaces, before it's added to the
+// shell. The pairs of surfaces get intersected in parallel, so a pair can't
+// see the curves from the other pairs; if an exact curve found nothing to
+// follow in the shell, then it might have to follow a curve from one of
+// those pairs instead, so it's unmatched.
+class SCurveCandidate {
+public:
+    SCurve          sc;
+    bool            keep;
+    bool            unmatched;
+};
+
 // A segment of a curve by which a surface is trimmed: indicates which curve,
 // by its handle, and the starting and ending points of our segment of it.
 // The vector out points out of the surface; it, the surface outer normal,
@@ -266,10 +278,6 @@ public:
     SBspUv          *bsp;
     SEdgeList       edges;
 
-    // For caching our initial (u, v) when doing Newton iterations to project
-    // a point into our surface.
-    Point2d         cached;
-
     static SSurface FromExtrusionOf(SBezier *spc, Vector t0, Vector t1);
     static SSurface FromRevolutionOf(SBezier *sb, Vector pt, Vector axis,
                                         double thetas, double thetaf);
@@ -286,12 +294,15 @@ public:
                                   SShell *shell, SShell *sha, SShell *shb);
     void FindChainAvoiding(SEdgeList *src, SEdgeList *dest, SPointList *avoid);
     SSurface MakeCopyTrimAgainst(SShell *parent, SShell *a, SShell *b,
-                                    SShell *into, int type);
+                                    SShell *into, int type,
+                                    bool *failed, SEdgeList *naked);
     void TrimFromEdgeList(SEdgeList *el, bool asUv);
     void IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
-                          SShell *into);
+                          SShell *into, std::vector<SCurveCandidate> *out);
     void AddExactIntersectionCurve(SBezier *sb, SSurface *srfB,
-                          SShell *agnstA, SShell *agnstB, SShell *into);
+                          SShell *agnstA, SShell *agnstB, SShell *into,
+                          std::vector<SCurveCandidate> *out);
+    bool CurveLiesWithin(SCurve *sc, SSurface *srfB);
 
     typedef struct {
         int     tag;
@@ -315,6 +326,8 @@ public:
     void ClosestPointTo(Vector p, Point2d *puv, bool converge=true);
     void ClosestPointTo(Vector p, double *u, double *v, bool converge=true);
     bool ClosestPointNewton(Vector p, double *u, double *v, bool converge=true);
+    static void ForgetClosestPoints(void);
+    static void ForEachInParallel(int n, const std::function<void(int)> &fn);
 
     bool PointIntersectingLine(Vector p0, Vector p1, double *u, double *v);
     Vector ClosestPointOnThisAndSurface(SSurface *srf2, Vector p);
@@ -356,6 +369,34 @@ public:
     void Clear(void);
 };
 
+// A bounding volume hierarchy over the surfaces of a shell, so that we can
+// find the surfaces whose bounding boxes overlap a given box without testing
+// all of them. Surfaces are referred to by their index in the shell's list.
+class SSurfaceBvh {
+public:
+    struct Node {
+        Vector  max, min;
+        // The children, or for a leaf, -1 and the surfaces in [first, last)
+        // of order.
+        int     left, right;
+        int     first, last;
+    };
+    std::vector<Node>   node;
+    std::vector<int>    order;
+    std::vector<Vector> srfMax, srfMin;
+    // The surfaces that this was built from, to tell if it's out of date
+    SSurface            *builtFrom = NULL;
+    uint32_t            builtGeneration = 0;
+
+    void Build(SShell *shell);
+    int BuildNode(int first, int last);
+    bool IsBuiltFrom(SShell *shell);
+    void Clear(void);
+
+    void FindOverlapping(Vector max, Vector min, std::vector<int> *found);
+    void FindCrossedBy(Vector a, Vector b, bool seg, std::vector<int> *found);
+};
+
 class SShell {
 public:
     IdList<SCurve,hSCurve>      curve;
@@ -363,6 +404,9 @@ public:
 
     bool                        booleanFailed;
 
+    // The surfaces' bounding boxes, for ray casting; see GetSurfaceBvh().
+    SSurfaceBvh                 bvh;
+
     void MakeFromExtrusionOf(SBezierLoopSet *sbls, Vector t0, Vector t1,
                              RgbaColor color);
     void MakeFromRevolutionOf(SBezierLoopSet *sbls, Vector pt, Vector axis,
@@ -380,7 +424,12 @@ public:
     void CopySurfacesTrimAgainst(SShell *sha, SShell *shb, SShell *into,
                                     int type);
     void MakeIntersectionCurvesAgainst(SShell *against, SShell *into);
+    SCurve *FindExactCurve(SBezier *sb, int first, bool *backwards);
+    void AddIntersectionCurves(SSurface *srfA, SShell *agnst, int firstNew,
+                               std::vector<SCurveCandidate> *cands,
+                               uint64_t *intersected);
     void MakeClassifyingBsps(SShell *useCurvesFrom);
+    SSurfaceBvh *GetSurfaceBvh(void);
     void AllPointsIntersecting(Vector a, Vector b, List<SInter> *il,
                                 bool seg, bool trimmed, bool inclTangent);
     void MakeCoincidentEdgesInto(SSurface *proto, bool sameNormal,
@@ -415,6 +464,7 @@ public:
     void MakeSectionEdgesInto(Vector n, double d,
                                 SEdgeList *sel, SBezierList *sbl);
     bool IsEmpty(void);
+    void GetBounding(Vector *vmax, Vector *vmin);
     void RemapFaces(Group *g, int remap);
     void Clear(void);
 };
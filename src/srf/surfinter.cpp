@@ -9,56 +9,37 @@
 
 extern int FLAG;
 
-void SSurface::AddExactIntersectionCurve(SBezier *sb, SSurface *srfB,
-                            SShell *agnstA, SShell *agnstB, SShell *into)
-{
-    SCurve sc = {};
-    // Important to keep the order of (surfA, surfB) consistent; when we later
-    // rewrite the identifiers, we rewrite surfA from A and surfB from B.
-    sc.surfA = h;
-    sc.surfB = srfB->h;
-    sc.exact = *sb;
-    sc.isExact = true;
-
-    // Now we have to piecewise linearize the curve. If there's already an
-    // identical curve in the shell, then follow that pwl exactly, otherwise
-    // calculate from scratch.
-    SCurve split, *existing = NULL, *se;
+//-----------------------------------------------------------------------------
+// Find the first exact curve in the shell, at or after index first, that's
+// identical to sb, either as is or reversed.
+//-----------------------------------------------------------------------------
+SCurve *SShell::FindExactCurve(SBezier *sb, int first, bool *backwards) {
     SBezier sbrev = *sb;
     sbrev.Reverse();
-    bool backwards = false;
-    for(se = into->curve.First(); se; se = into->curve.NextAfter(se)) {
-        if(se->isExact) {
-            if(sb->Equals(&(se->exact))) {
-                existing = se;
-                break;
-            }
-            if(sbrev.Equals(&(se->exact))) {
-                existing = se;
-                backwards = true;
-                break;
-            }
+    int i;
+    for(i = first; i < curve.n; i++) {
+        SCurve *se = &(curve.elem[i]);
+        if(!se->isExact) continue;
+        if(sb->Equals(&(se->exact))) {
+            *backwards = false;
+            return se;
         }
-    }
-    if(existing) {
-        SCurvePt *v;
-        for(v = existing->pts.First(); v; v = existing->pts.NextAfter(v)) {
-            sc.pts.Add(v);
+        if(sbrev.Equals(&(se->exact))) {
+            *backwards = true;
+            return se;
         }
-        if(backwards) sc.pts.Reverse();
-        split = sc;
-        sc = {};
-    } else {
-        sb->MakePwlInto(&(sc.pts));
-        // and split the line where it intersects our existing surfaces
-        split = sc.MakeCopySplitAgainst(agnstA, agnstB, this, srfB);
-        sc.Clear();
     }
+    return NULL;
+}
 
-    // Test if the curve lies entirely outside one of the
+//-----------------------------------------------------------------------------
+// Test if a curve lies within both this surface and srfB; if it lies entirely
+// outside one of them, then it's not a real intersection.
+//-----------------------------------------------------------------------------
+bool SSurface::CurveLiesWithin(SCurve *sc, SSurface *srfB) {
     SCurvePt *scpt;
     bool withinA = false, withinB = false;
-    for(scpt = split.pts.First(); scpt; scpt = split.pts.NextAfter(scpt)) {
+    for(scpt = sc->pts.First(); scpt; scpt = sc->pts.NextAfter(scpt)) {
         double tol = 0.01;
         Point2d puv;
         ClosestPointTo(scpt->p, &puv);
@@ -76,36 +57,106 @@ void SSurface::AddExactIntersectionCurve(SBezier *sb, SSurface *srfB,
         // Break out early, no sense wasting time if we already have the answer.
         if(withinA && withinB) break;
     }
-    if(!(withinA && withinB)) {
+    return (withinA && withinB);
+}
+
+void SSurface::AddExactIntersectionCurve(SBezier *sb, SSurface *srfB,
+                            SShell *agnstA, SShell *agnstB, SShell *into,
+                            std::vector<SCurveCandidate> *out)
+{
+    SCurveCandidate cand = {};
+    SCurve *sc = &(cand.sc);
+    // Important to keep the order of (surfA, surfB) consistent; when we later
+    // rewrite the identifiers, we rewrite surfA from A and surfB from B.
+    sc->surfA = h;
+    sc->surfB = srfB->h;
+    sc->exact = *sb;
+    sc->isExact = true;
+    sc->source = SCurve::FROM_INTERSECTION;
+
+    // Now we have to piecewise linearize the curve. If there's already an
+    // identical curve in the shell, then follow that pwl exactly, otherwise
+    // calculate from scratch.
+    bool backwards;
+    SCurve *existing = into->FindExactCurve(sb, 0, &backwards);
+    if(existing) {
+        SCurvePt *v;
+        for(v = existing->pts.First(); v; v = existing->pts.NextAfter(v)) {
+            sc->pts.Add(v);
+        }
+        if(backwards) sc->pts.Reverse();
+    } else {
+        SCurve pwl = *sc;
+        pwl.pts = {};
+        sb->MakePwlInto(&(pwl.pts));
+        // and split the line where it intersects our existing surfaces
+        *sc = pwl.MakeCopySplitAgainst(agnstA, agnstB, this, srfB);
+        pwl.Clear();
+        // An earlier pair of surfaces might still generate an identical
+        // curve, which we'd have to follow instead.
+        cand.unmatched = true;
+    }
+
+    cand.keep = CurveLiesWithin(sc, srfB);
+    if(!cand.keep) {
         // Intersection curve lies entirely outside one of the surfaces, so
         // it's fake.
-        split.Clear();
-        return;
+        sc->pts.Clear();
+        if(!cand.unmatched) return;
     }
+    out->push_back(cand);
+}
 
-#if 0
-    if(sb->deg == 2) {
-        dbp(" ");
-        SCurvePt *prev = NULL, *v;
-        dbp("split.pts.n = %d", split.pts.n);
-        for(v = split.pts.First(); v; v = split.pts.NextAfter(v)) {
-            if(prev) {
-                Vector e = (prev->p).Minus(v->p).WithMagnitude(0);
-                SS.nakedEdges.AddEdge((prev->p).Plus(e), (v->p).Minus(e));
+//-----------------------------------------------------------------------------
+// Add the candidate curves from intersecting srfA (from this shell) against
+// the surfaces of agnst to into, in the order that they were generated. The
+// curves from index firstNew on came from earlier pairs of surfaces, which
+// the candidates couldn't see yet; so if an unmatched candidate is identical
+// to one of those, then make it follow that one's pwl, just as if we'd
+// intersected all the pairs in order.
+//-----------------------------------------------------------------------------
+void SShell::AddIntersectionCurves(SSurface *srfA, SShell *agnst, int firstNew,
+                                   std::vector<SCurveCandidate> *cands,
+                                   uint64_t *intersected)
+{
+    uint32_t lastB = 0;
+    for(SCurveCandidate &cand : *cands) {
+        SCurve *sc = &(cand.sc);
+        SSurface *srfB = agnst->surface.FindById(sc->surfB);
+        bool backwards;
+        SCurve *existing = NULL;
+        if(cand.unmatched) {
+            existing = FindExactCurve(&(sc->exact), firstNew, &backwards);
+        }
+        if(existing) {
+            sc->pts.Clear();
+            SCurvePt *v;
+            for(v = existing->pts.First(); v; v = existing->pts.NextAfter(v)) {
+                sc->pts.Add(v);
             }
-            prev = v;
+            if(backwards) sc->pts.Reverse();
+            cand.keep = srfA->CurveLiesWithin(sc, srfB);
         }
-    }
-#endif // 0
-    // Nothing should be generating zero-len edges.
-    if((sb->Start()).Equals(sb->Finish())) oops();
 
-    split.source = SCurve::FROM_INTERSECTION;
-    into->curve.AddAndAssignId(&split);
+        if(!cand.keep) {
+            sc->Clear();
+            continue;
+        }
+        // Nothing should be generating zero-len edges.
+        if(sc->isExact && (sc->exact.Start()).Equals(sc->exact.Finish())) {
+            oops();
+        }
+        curve.AddAndAssignId(sc);
+        if(sc->surfB.v != lastB) {
+            (*intersected)++;
+            lastB = sc->surfB.v;
+        }
+    }
+    cands->clear();
 }
 
 void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
-                                SShell *into)
+                                SShell *into, std::vector<SCurveCandidate> *out)
 {
     Vector amax, amin, bmax, bmin;
     GetAxisAlignedBounding(&amax, &amin);
@@ -179,7 +230,7 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
         if(tmax > tmin + LENGTH_EPS) {
             SBezier bezier = SBezier::From(p.Plus(dl.ScaledBy(tmin)),
                                            p.Plus(dl.ScaledBy(tmax)));
-            AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into);
+            AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into, out);
         }
     } else if((degm == 1 && degn == 1 && isExtdb) ||
               (b->degm == 1 && b->degn == 1 && isExtdt))
@@ -224,7 +275,7 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
                 Vector al = along.ScaledBy(0.5);
                 SBezier bezier;
                 bezier = SBezier::From((si->p).Minus(al), (si->p).Plus(al));
-                AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into);
+                AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into, out);
             }
 
             inters.Clear();
@@ -240,7 +291,7 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
                     Vector::AtIntersectionOfPlaneAndLine(n, d, p0, p1, NULL);
             }
 
-            AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into);
+            AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into, out);
         }
     } else if(isExtdt && isExtdb &&
                 sqrt(fabs(alongt.Dot(alongb))) >
@@ -300,7 +351,7 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
 
             SBezier bezier;
             bezier = SBezier::From(p.Plus(axis0), p.Plus(axis1));
-            AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into);
+            AddExactIntersectionCurve(&bezier, b, agnstA, agnstB, into, out);
         }
 
         inters.Clear();
@@ -371,7 +422,7 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
                    startv = spl.l.elem[0].auxv;
             spl.l.ClearTags();
             spl.l.elem[0].tag = 1;
-            spl.l.RemoveTagged();
+            spl.RemoveTagged();
 
             // Our chord tolerance is whatever the user specified
             double maxtol = SS.ChordTolMm();
@@ -445,12 +496,14 @@ void SSurface::IntersectAgainst(SSurface *b, SShell *agnstA, SShell *agnstB,
                 start = npc;
             }
 
-            spl.l.RemoveTagged();
+            spl.RemoveTagged();
 
             // And now we split and insert the curve
-            SCurve split = sc.MakeCopySplitAgainst(agnstA, agnstB, this, b);
+            SCurveCandidate cand = {};
+            cand.sc = sc.MakeCopySplitAgainst(agnstA, agnstB, this, b);
+            cand.keep = true;
             sc.Clear();
-            into->curve.AddAndAssignId(&split);
+            out->push_back(cand);
         }
         spl.Clear();
     }
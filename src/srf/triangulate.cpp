@@ -1,16 +1,44 @@
 //-----------------------------------------------------------------------------
 // Triangulate a surface. If the surface is curved, then we first superimpose
 // a grid of quads, with spacing to achieve our chord tolerance. We then
-// proceed by ear-clipping; the resulting mesh should be watertight and not
-// awful numerically, but has no special properties (Delaunay, etc.).
+// proceed by ear-clipping (or on a plane, by sweep line); the resulting mesh
+// should be watertight and not awful numerically, but has no special
+// properties (Delaunay, etc.).
 //
 // Copyright 2008-2013 Jonathan Westhues.
 //-----------------------------------------------------------------------------
 #include "../solvespace.h"
 
+// We would like to apply our tolerances in xyz; but that would be a lot of
+// work, so at least scale the epsilon semi-reasonably. That's perfect for
+// square planes, less perfect for anything else.
+static double ScaledEpsFor(SSurface *srf) {
+    Vector tu, tv;
+    srf->TangentsAt(0.5, 0.5, &tu, &tv);
+    double s = sqrt(tu.MagSquared() + tv.MagSquared());
+    return LENGTH_EPS / s;
+}
+
 void SPolygon::UvTriangulateInto(SMesh *m, SSurface *srf) {
     if(l.n <= 0) return;
 
+    // On a plane, any triangulation is as good as any other, so use the
+    // sweep if we may; it's O(n log n), where bridging the holes and then
+    // clipping ears gets quadratic or worse. It gives up on input that's
+    // degenerate in ways that the ear clipping can cope with, so then fall
+    // through to that.
+    if(SS.monotoneTriangulation && srf->degm == 1 && srf->degn == 1) {
+        List<STriangle> tl = {};
+        if(MonotoneTriangulateInto(&tl, ScaledEpsFor(srf))) {
+            for(int i = 0; i < tl.n; i++) {
+                m->AddTriangle(&(tl.elem[i]));
+            }
+            tl.Clear();
+            return;
+        }
+        tl.Clear();
+    }
+
     //int64_t in = GetMilliseconds();
 
     normal = Vector::From(0, 0, 1);
@@ -287,13 +315,7 @@ void SContour::ClipEarInto(SMesh *m, int bp, double scaledEps) {
 }
 
 void SContour::UvTriangulateInto(SMesh *m, SSurface *srf) {
-    Vector tu, tv;
-    srf->TangentsAt(0.5, 0.5, &tu, &tv);
-    double s = sqrt(tu.MagSquared() + tv.MagSquared());
-    // We would like to apply our tolerances in xyz; but that would be a lot
-    // of work, so at least scale the epsilon semi-reasonably. That's
-    // perfect for square planes, less perfect for anything else.
-    double scaledEps = LENGTH_EPS / s;
+    double scaledEps = ScaledEpsFor(srf);
 
     int i;
     // Clean the original contour by removing any zero-length edges.
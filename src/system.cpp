@@ -19,59 +19,103 @@ const double System::RANK_MAG_TOLERANCE = 1e-4;
 // always be much less than LENGTH_EPS, and in practice should be much less.
 const double System::CONVERGE_TOLERANCE = (LENGTH_EPS/(1e2));
 
-bool System::WriteJacobian(int tag) {
-    int a, i, j;
-
-    j = 0;
+void System::WriteJacobian(int tag, Matrix *mtx) {
+    int a;
+
+    // The columns are the params with this tag; and for each entry in the
+    // param table, the column that it got, or -1.
+    std::vector<int> colOf(param.n, -1);
+    mtx->param.clear();
+    mtx->paramp.clear();
+    mtx->scale.clear();
     for(a = 0; a < param.n; a++) {
-        if(j >= MAX_UNKNOWNS) return false;
-
         Param *p = &(param.elem[a]);
         if(p->tag != tag) continue;
-        mat.param[j] = p->h;
-        j++;
+        colOf[a] = (int)mtx->param.size();
+        mtx->param.push_back(p->h);
+        mtx->paramp.push_back(p);
+        // This scale weights the parameters for the least squares solve, so
+        // that we can encourage the solver to make bigger changes in some
+        // parameters, and smaller in others.
+        if(IsDragged(p->h)) {
+            // It's least squares, so this parameter doesn't need to be all
+            // that big to get a large effect.
+            mtx->scale.push_back(1/20.0);
+        } else {
+            mtx->scale.push_back(1);
+        }
     }
-    mat.n = j;
+    mtx->n = (int)mtx->param.size();
 
-    i = 0;
-    for(a = 0; a < eq.n; a++) {
-        if(i >= MAX_UNKNOWNS) return false;
+    mtx->eq.clear();
+    mtx->A.start.clear();
+    mtx->A.col.clear();
+    mtx->A.start.push_back(0);
 
+    std::vector<Expr *> fs;
+    std::vector<hParam> used;
+    std::vector<int> cols;
+    for(a = 0; a < eq.n; a++) {
         Equation *e = &(eq.elem[a]);
         if(e->tag != tag) continue;
 
-        mat.eq[i] = e->h;
+        mtx->eq.push_back(e->h);
         Expr *f = e->e->DeepCopyWithParamsAsPointers(&param, &(SK.param));
         f = f->FoldConstants();
 
-        // Hash table (61 bits) to accelerate generation of zero partials.
-        uint64_t scoreboard = f->ParamsUsed();
-        for(j = 0; j < mat.n; j++) {
-            Expr *pd;
-            if(scoreboard & ((uint64_t)1 << (mat.param[j].v % 61)) &&
-                f->DependsOn(mat.param[j]))
-            {
-                pd = f->PartialWrt(mat.param[j]);
-                pd = pd->FoldConstants();
-                pd = pd->DeepCopyWithParamsAsPointers(&param, &(SK.param));
-            } else {
-                pd = Expr::From(0.0);
-            }
-            mat.A.sym[i][j] = pd;
+        // Only the unknowns that actually appear in the equation can have
+        // a non-zero partial, so there's no need to look at the others.
+        used.clear();
+        f->ParamsUsedList(&used);
+        cols.clear();
+        for(hParam hp : used) {
+            int pi = param.IndexOf(hp);
+            if(pi >= 0 && colOf[pi] >= 0) cols.push_back(colOf[pi]);
         }
-        mat.B.sym[i] = f;
-        i++;
+        std::sort(cols.begin(), cols.end());
+        cols.erase(std::unique(cols.begin(), cols.end()), cols.end());
+
+        mtx->A.col.insert(mtx->A.col.end(), cols.begin(), cols.end());
+        mtx->A.start.push_back((int)mtx->A.col.size());
+        fs.push_back(f);
     }
-    mat.m = i;
+    mtx->m = (int)mtx->eq.size();
 
-    return true;
+    // The partials aren't written symbolically; we get each row of the
+    // Jacobian by differentiating its equation in reverse mode, on the tape.
+    mtx->tape.Clear();
+    for(Expr *f : fs) {
+        mtx->tape.AddOutput(f);
+    }
+    mtx->paramSlot.clear();
+    for(Param *p : mtx->paramp) {
+        mtx->paramSlot.push_back(mtx->tape.SlotOfParam(p));
+    }
+    mtx->tape.DoneAdding();
+
+    mtx->A.num.assign(mtx->A.col.size(), 0.0);
+    mtx->B.num.assign(mtx->m, 0.0);
+    mtx->X.assign(mtx->n, 0.0);
+    // and any factorization is now stale
+    mtx->L.clear();
+    mtx->D.clear();
+    mtx->factoredForStep = false;
 }
 
-void System::EvalJacobian(void) {
-    int i, j;
-    for(i = 0; i < mat.m; i++) {
-        for(j = 0; j < mat.n; j++) {
-            mat.A.num[i][j] = (mat.A.sym[i][j])->Eval();
+void System::Matrix::EvalResiduals(void) {
+    tape.Run();
+    for(int i = 0; i < m; i++) {
+        B.num[i] = tape.slot[tape.outSlot[i]];
+    }
+}
+
+void System::Matrix::EvalJacobian(void) {
+    factoredForStep = false;
+    tape.Run();
+    for(int i = 0; i < m; i++) {
+        tape.Reverse(i);
+        for(int k = A.start[i]; k < A.start[i+1]; k++) {
+            A.num[k] = tape.adj[paramSlot[A.col[k]]];
         }
     }
 }
@@ -131,189 +175,226 @@ void System::SolveBySubstitution(void) {
 }
 
 //-----------------------------------------------------------------------------
-// Calculate the rank of the Jacobian matrix, by Gram-Schimdt orthogonalization
-// in place. A row (~equation) is considered to be all zeros if its magnitude
-// is less than the tolerance RANK_MAG_TOLERANCE.
+// Factor A*A' as L*D*L'. This is the same thing as Gram-Schmidt
+// orthogonalization of the rows of A: D[i] is the squared magnitude of row i,
+// after subtracting off its component in the direction of all previous rows.
+// So a row whose pivot is no bigger than tol is (to within that tolerance) a
+// linear combination of the rows before it; it's dropped, and left out of the
+// factorization. The return value is the number of rows kept, which is the
+// rank of A.
+//
+// Everything is kept sparse, since each constraint equation references only
+// a few unknowns, and A*A' is mostly zeros too.
 //-----------------------------------------------------------------------------
-int System::CalculateRank(void) {
-    // Actually work with magnitudes squared, not the magnitudes
-    double rowMag[MAX_UNKNOWNS] = {};
-    double tol = RANK_MAG_TOLERANCE*RANK_MAG_TOLERANCE;
+int System::Matrix::FactorAAt(double tol) {
+    int i, j, k;
 
-    int i, iprev, j;
-    int rank = 0;
+    factoredForStep = false;
 
-    for(i = 0; i < mat.m; i++) {
-        // Subtract off this row's component in the direction of any
-        // previous rows
-        for(iprev = 0; iprev < i; iprev++) {
-            if(rowMag[iprev] <= tol) continue; // ignore zero rows
+    // The columns of A, so that we can find the rows that share an unknown.
+    std::vector<SparseVector> acol(n);
+    for(i = 0; i < m; i++) {
+        for(k = A.start[i]; k < A.start[i+1]; k++) {
+            acol[A.col[k]].push_back({ i, A.num[k] });
+        }
+    }
 
-            double dot = 0;
-            for(j = 0; j < mat.n; j++) {
-                dot += (mat.A.num[iprev][j]) * (mat.A.num[i][j]);
-            }
-            for(j = 0; j < mat.n; j++) {
-                mat.A.num[i][j] -= (dot/rowMag[iprev])*mat.A.num[iprev][j];
+    // Write the upper triangle of A*A', by rows, accumulating each row into
+    // a dense scratch vector.
+    std::vector<SparseVector> U(m);
+    std::vector<double> work(m, 0.0);
+    std::vector<int> mark(m, -1), nz;
+    for(i = 0; i < m; i++) {
+        nz.clear();
+        for(k = A.start[i]; k < A.start[i+1]; k++) {
+            double aik = A.num[k];
+            for(const SparseElem &se : acol[A.col[k]]) {
+                if(se.idx < i) continue;
+                if(mark[se.idx] != i) {
+                    mark[se.idx] = i;
+                    work[se.idx] = 0;
+                    nz.push_back(se.idx);
+                }
+                work[se.idx] += aik*se.val;
             }
         }
-        // Our row is now normal to all previous rows; calculate the
-        // magnitude of what's left
-        double mag = 0;
-        for(j = 0; j < mat.n; j++) {
-            mag += (mat.A.num[i][j]) * (mat.A.num[i][j]);
+        std::sort(nz.begin(), nz.end());
+        U[i].reserve(nz.size());
+        for(j = 0; j < (int)nz.size(); j++) {
+            U[i].push_back({ nz[j], work[nz[j]] });
         }
-        if(mag > tol) {
-            rank++;
+    }
+
+    // And eliminate, one row at a time; the rows of U become the columns
+    // of L.
+    L.assign(m, SparseVector());
+    D.assign(m, 0.0);
+    int rank = 0;
+    SparseVector merged;
+    for(k = 0; k < m; k++) {
+        SparseVector &rk = U[k];
+        double d = (!rk.empty() && rk[0].idx == k) ? rk[0].val : 0;
+        if(d <= tol) {
+            // Dependent on the rows before it, so ignore it.
+            SparseVector().swap(rk);
+            continue;
+        }
+        rank++;
+        D[k] = d;
+
+        for(size_t p = 1; p < rk.size(); p++) {
+            double l = rk[p].val / d;
+            L[k].push_back({ rk[p].idx, l });
+
+            // Row i of what's left loses l times row k, from column i on;
+            // and both rows are sorted, so just merge them.
+            SparseVector &ri = U[rk[p].idx];
+            merged.clear();
+            size_t pi = 0, pk = p;
+            while(pi < ri.size() || pk < rk.size()) {
+                if(pk >= rk.size() ||
+                   (pi < ri.size() && ri[pi].idx < rk[pk].idx))
+                {
+                    merged.push_back(ri[pi++]);
+                } else if(pi >= ri.size() || rk[pk].idx < ri[pi].idx) {
+                    merged.push_back({ rk[pk].idx, -l*rk[pk].val });
+                    pk++;
+                } else {
+                    merged.push_back({ ri[pi].idx, ri[pi].val - l*rk[pk].val });
+                    pi++;
+                    pk++;
+                }
+            }
+            ri.swap(merged);
         }
-        rowMag[i] = mag;
+        SparseVector().swap(rk);
     }
 
     return rank;
 }
 
-bool System::TestRank(void) {
-    EvalJacobian();
-    return CalculateRank() == mat.m;
-}
+//-----------------------------------------------------------------------------
+// Solve (A*A')*z = b, given the factorization from FactorAAt(). On input Z is
+// b, and on output z. Any dropped rows get z = 0, so a consistent but
+// singular system still gets a solution.
+//-----------------------------------------------------------------------------
+void System::Matrix::SolveFactored(std::vector<double> *pz) {
+    std::vector<double> &z = *pz;
+    int k;
 
-bool System::SolveLinearSystem(double X[], double A[][MAX_UNKNOWNS],
-                               double B[], int n)
-{
-    // Gaussian elimination, with partial pivoting. It's an error if the
-    // matrix is singular, because that means two constraints are
-    // equivalent.
-    int i, j, ip, jp, imax = 0;
-    double max, temp;
-
-    for(i = 0; i < n; i++) {
-        // We are trying eliminate the term in column i, for rows i+1 and
-        // greater. First, find a pivot (between rows i and N-1).
-        max = 0;
-        for(ip = i; ip < n; ip++) {
-            if(ffabs(A[ip][i]) > max) {
-                imax = ip;
-                max = ffabs(A[ip][i]);
-            }
+    for(k = 0; k < m; k++) {
+        for(const SparseElem &se : L[k]) {
+            z[se.idx] -= se.val*z[k];
         }
-        // Don't give up on a singular matrix unless it's really bad; the
-        // assumption code is responsible for identifying that condition,
-        // so we're not responsible for reporting that error.
-        if(ffabs(max) < 1e-20) continue;
-
-        // Swap row imax with row i
-        for(jp = 0; jp < n; jp++) {
-            swap(A[i][jp], A[imax][jp]);
+    }
+    for(k = 0; k < m; k++) {
+        z[k] = (D[k] > 0) ? z[k] / D[k] : 0;
+    }
+    for(k = m - 1; k >= 0; k--) {
+        for(const SparseElem &se : L[k]) {
+            z[k] -= se.val*z[se.idx];
         }
-        swap(B[i], B[imax]);
+    }
+}
 
-        // For rows i+1 and greater, eliminate the term in column i.
-        for(ip = i+1; ip < n; ip++) {
-            temp = A[ip][i]/A[i][i];
+//-----------------------------------------------------------------------------
+// Calculate the rank of the Jacobian matrix. A row (~equation) is considered
+// to be all zeros if its magnitude, after we subtract off its component
+// along all the previous rows, is less than the tolerance RANK_MAG_TOLERANCE.
+//-----------------------------------------------------------------------------
+int System::Matrix::CalculateRank(void) {
+    // Actually work with magnitudes squared, not the magnitudes
+    return FactorAAt(RANK_MAG_TOLERANCE*RANK_MAG_TOLERANCE);
+}
 
-            for(jp = i; jp < n; jp++) {
-                A[ip][jp] -= temp*(A[i][jp]);
-            }
-            B[ip] -= temp*B[i];
-        }
-    }
+bool System::Matrix::TestRank(void) {
+    EvalJacobian();
+    return CalculateRank() == m;
+}
 
-    // We've put the matrix in upper triangular form, so at this point we
-    // can solve by back-substitution.
-    for(i = n - 1; i >= 0; i--) {
-        if(ffabs(A[i][i]) < 1e-20) continue;
+bool System::Matrix::SolveLeastSquares(void) {
+    FactorForStep();
+    SolveForStep();
+    return true;
+}
 
-        temp = B[i];
-        for(j = n - 1; j > i; j--) {
-            temp -= X[j]*A[i][j];
-        }
-        X[i] = temp / A[i][i];
+void System::Matrix::FactorForStep(void) {
+    // Scale the columns, by the weights that we chose when we wrote the
+    // Jacobian.
+    for(int k = 0; k < (int)A.num.size(); k++) {
+        A.num[k] *= scale[A.col[k]];
     }
 
-    return true;
+    // Factor A*A'. Don't give up on a singular matrix unless it's really
+    // bad; the assumption code is responsible for identifying that
+    // condition, so we're not responsible for reporting that error.
+    FactorAAt(1e-20);
+    factoredForStep = true;
 }
 
-bool System::SolveLeastSquares(void) {
-    int r, c, i;
+//-----------------------------------------------------------------------------
+// Find the least squares step X for the residuals in B, using the scaled
+// Jacobian in A and its factorization from FactorForStep().
+//-----------------------------------------------------------------------------
+void System::Matrix::SolveForStep(void) {
+    int r, c, k;
 
-    // Scale the columns; this scale weights the parameters for the least
-    // squares solve, so that we can encourage the solver to make bigger
-    // changes in some parameters, and smaller in others.
-    for(c = 0; c < mat.n; c++) {
-        if(IsDragged(mat.param[c])) {
-            // It's least squares, so this parameter doesn't need to be all
-            // that big to get a large effect.
-            mat.scale[c] = 1/20.0;
-        } else {
-            mat.scale[c] = 1;
-        }
-        for(r = 0; r < mat.m; r++) {
-            mat.A.num[r][c] *= mat.scale[c];
-        }
-    }
+    Z = B.num;
+    SolveFactored(&(Z));
 
-    // Write A*A'
-    for(r = 0; r < mat.m; r++) {
-        for(c = 0; c < mat.m; c++) {  // yes, AAt is square
-            double sum = 0;
-            for(i = 0; i < mat.n; i++) {
-                sum += mat.A.num[r][i]*mat.A.num[c][i];
-            }
-            mat.AAt[r][c] = sum;
+    // And multiply that by A' to get our solution.
+    for(c = 0; c < n; c++) {
+        X[c] = 0;
+    }
+    for(r = 0; r < m; r++) {
+        for(k = A.start[r]; k < A.start[r+1]; k++) {
+            X[A.col[k]] += A.num[k]*Z[r];
         }
     }
+    for(c = 0; c < n; c++) {
+        X[c] *= scale[c];
+    }
+}
 
-    if(!SolveLinearSystem(mat.Z, mat.AAt, mat.B.num, mat.m)) return false;
-
-    // And multiply that by A' to get our solution.
-    for(c = 0; c < mat.n; c++) {
-        double sum = 0;
-        for(i = 0; i < mat.m; i++) {
-            sum += mat.A.num[i][c]*mat.Z[i];
+// Take the Newton step;
+//      J(x_n) (x_{n+1} - x_n) = 0 - F(x_n)
+bool System::Matrix::TakeStep(void) {
+    for(int i = 0; i < n; i++) {
+        Param *p = paramp[i];
+        p->val -= X[i];
+        if(isnan(p->val)) {
+            // Very bad, and clearly not convergent
+            return false;
         }
-        mat.X[c] = sum * mat.scale[c];
     }
     return true;
 }
 
-bool System::NewtonSolve(int tag) {
+bool System::Matrix::NewtonSolve(void) {
 
     int iter = 0;
     bool converged = false;
     int i;
 
     // Evaluate the functions at our operating point.
-    for(i = 0; i < mat.m; i++) {
-        mat.B.num[i] = (mat.B.sym[i])->Eval();
-    }
+    EvalResiduals();
     do {
         // And evaluate the Jacobian at our initial operating point.
         EvalJacobian();
 
         if(!SolveLeastSquares()) break;
 
-        // Take the Newton step;
-        //      J(x_n) (x_{n+1} - x_n) = 0 - F(x_n)
-        for(i = 0; i < mat.n; i++) {
-            Param *p = param.FindById(mat.param[i]);
-            p->val -= mat.X[i];
-            if(isnan(p->val)) {
-                // Very bad, and clearly not convergent
-                return false;
-            }
-        }
+        if(!TakeStep()) return false;
 
         // Re-evalute the functions, since the params have just changed.
-        for(i = 0; i < mat.m; i++) {
-            mat.B.num[i] = (mat.B.sym[i])->Eval();
-        }
+        EvalResiduals();
         // Check for convergence
         converged = true;
-        for(i = 0; i < mat.m; i++) {
-            if(isnan(mat.B.num[i])) {
+        for(i = 0; i < m; i++) {
+            if(isnan(B.num[i])) {
                 return false;
             }
-            if(ffabs(mat.B.num[i]) > CONVERGE_TOLERANCE) {
+            if(ffabs(B.num[i]) > CONVERGE_TOLERANCE) {
                 converged = false;
                 break;
             }
@@ -323,6 +404,121 @@ bool System::NewtonSolve(int tag) {
     return converged;
 }
 
+//-----------------------------------------------------------------------------
+// Solve again from initial guesses that are close to the last solution, like
+// while the user drags something. The Jacobian doesn't change much over such
+// a small distance, so first try some simplified Newton steps that reuse its
+// factorization from last time; if those don't converge quickly, then go
+// back to where we started and do it properly.
+//-----------------------------------------------------------------------------
+bool System::Matrix::SolveNearby(void) {
+    int i, iter;
+
+    if(factoredForStep) {
+        std::vector<double> start(n);
+        for(i = 0; i < n; i++) {
+            start[i] = paramp[i]->val;
+        }
+
+        double last = VERY_POSITIVE;
+        EvalResiduals();
+        for(iter = 0; iter < 10; iter++) {
+            double worst = 0;
+            for(i = 0; i < m; i++) {
+                if(isnan(B.num[i])) {
+                    worst = VERY_POSITIVE;
+                    break;
+                }
+                worst = max(worst, ffabs(B.num[i]));
+            }
+            if(worst <= CONVERGE_TOLERANCE) return true;
+            // Each step should make good progress, or it's not worth it.
+            if(worst > last/2) break;
+            last = worst;
+
+            SolveForStep();
+            if(!TakeStep()) break;
+            EvalResiduals();
+        }
+
+        for(i = 0; i < n; i++) {
+            paramp[i]->val = start[i];
+        }
+    }
+    return NewtonSolve();
+}
+
+//-----------------------------------------------------------------------------
+// Mark which of the params in our columns are free, given that the rows of
+// the Jacobian are independent. Without a param's column, they stay
+// independent unless that param's unit vector lies in the row space; and
+// the square of its distance from that is 1 - a'*(A*A')^-1*a, for the
+// param's column a.
+// So that's one sparse forward substitution for each param, instead of a
+// rank test for each. Only the rows reachable from a's non-zeros through the
+// columns of L can become non-zero, so we visit just those, smallest first.
+//-----------------------------------------------------------------------------
+void System::Matrix::MarkFreeParams(void) {
+    int i, k;
+
+    EvalJacobian();
+    CalculateRank();
+
+    std::vector<SparseVector> acol(n);
+    for(i = 0; i < m; i++) {
+        for(k = A.start[i]; k < A.start[i+1]; k++) {
+            acol[A.col[k]].push_back({ i, A.num[k] });
+        }
+    }
+
+    // Solve L*w = a, and get w'*D^-1*w, leaving the scratch vectors clear.
+    std::vector<double> w(m, 0.0);
+    std::vector<bool> queued(m, false);
+    std::vector<int> rows;
+    std::greater<int> later;
+    auto reach = [&](int r) {
+        if(queued[r]) return;
+        queued[r] = true;
+        rows.push_back(r);
+        std::push_heap(rows.begin(), rows.end(), later);
+    };
+    for(int c = 0; c < n; c++) {
+        double inRowSpace = 0;
+        for(const SparseElem &se : acol[c]) {
+            w[se.idx] = se.val;
+            reach(se.idx);
+        }
+        while(!rows.empty()) {
+            std::pop_heap(rows.begin(), rows.end(), later);
+            k = rows.back();
+            rows.pop_back();
+            queued[k] = false;
+
+            double wk = w[k];
+            w[k] = 0;
+            if(wk == 0) continue;
+            for(const SparseElem &se : L[k]) {
+                w[se.idx] -= se.val*wk;
+                reach(se.idx);
+            }
+            if(D[k] > 0) inRowSpace += wk*wk/D[k];
+        }
+        double dist2 = 1 - inRowSpace;
+        paramp[c]->free = (dist2 > RANK_MAG_TOLERANCE*RANK_MAG_TOLERANCE);
+    }
+}
+
+//-----------------------------------------------------------------------------
+// Point the matrix at the params in a table that was written again since
+// we wrote the Jacobian, with the same params in it.
+//-----------------------------------------------------------------------------
+void System::Matrix::Rebind(ParamList *firstTry, ParamList *thenTry) {
+    for(int i = 0; i < n; i++) {
+        paramp[i] = firstTry->FindById(param[i]);
+    }
+    tape.Rebind(firstTry, thenTry);
+}
+
 void System::WriteEquationsExceptFor(hConstraint hc, Group *g) {
     int i;
     // Generate all the equations from constraints in this group
@@ -359,9 +555,87 @@ void System::WriteEquationsExceptFor(hConstraint hc, Group *g) {
     g->GenerateEquations(&eq);
 }
 
+//-----------------------------------------------------------------------------
+// True if the vectors are linearly independent; a vector is considered to be
+// dependent on the ones before it if its magnitude, after we subtract off
+// its component along those, is less than tol.
+//-----------------------------------------------------------------------------
+static bool LinearlyIndependent(std::vector<std::vector<double>> *pv,
+                                double tol)
+{
+    std::vector<std::vector<double>> &v = *pv;
+    size_t i, j, k;
+
+    for(i = 0; i < v.size(); i++) {
+        for(j = 0; j < i; j++) {
+            double dot = 0;
+            for(k = 0; k < v[i].size(); k++) dot += v[i][k]*v[j][k];
+            for(k = 0; k < v[i].size(); k++) v[i][k] -= dot*v[j][k];
+        }
+        double mag = 0;
+        for(k = 0; k < v[i].size(); k++) mag += v[i][k]*v[i][k];
+        mag = sqrt(mag);
+        if(mag < tol) return false;
+        for(k = 0; k < v[i].size(); k++) v[i][k] /= mag;
+    }
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Find the constraints that we could remove to make the Jacobian full rank.
+// Each row that the rank test drops is a combination of the rows before it,
+// so there's a vector y with y'*A = 0 for each; those span all the ways in
+// which the equations depend on each other. Removing a constraint leaves
+// the other equations independent exactly when every such dependency
+// involves its equations, which is when the y's restricted to its rows are
+// still linearly independent. So one factorization tells us about all the
+// constraints, instead of one for each.
+//-----------------------------------------------------------------------------
 void System::FindWhichToRemoveToFixJacobian(Group *g, List<hConstraint> *bad) {
-    int a, i;
+    int a, i, j, k;
 
+    // Substitution removes an equation and an unknown together, so it
+    // doesn't change which constraints are redundant; and it's simpler to
+    // consider all the equations at once without it.
+    param.ClearTags();
+    eq.Clear();
+    WriteEquationsExceptFor(Constraint::NO_CONSTRAINT, g);
+    eq.ClearTags();
+
+    WriteJacobian(0, &mat);
+    mat.EvalJacobian();
+    mat.CalculateRank();
+
+    // The rows that each constraint wrote
+    std::unordered_map<uint32_t, std::vector<int>> rowsOf;
+    size_t mostRows = 0;
+    for(i = 0; i < mat.m; i++) {
+        if(!mat.eq[i].isFromConstraint()) continue;
+        std::vector<int> &rows = rowsOf[mat.eq[i].constraint().v];
+        rows.push_back(i);
+        mostRows = max(mostRows, rows.size());
+    }
+
+    // Solve L'*y = e_i for each dropped row i; y is zero after row i.
+    std::vector<std::vector<double>> dep;
+    for(i = 0; i < mat.m; i++) {
+        if(mat.D[i] > 0) continue;
+        // No one constraint could be in all of these dependencies.
+        if(dep.size() == mostRows) return;
+
+        std::vector<double> y(i + 1, 0.0);
+        y[i] = 1;
+        for(k = i - 1; k >= 0; k--) {
+            for(const SparseElem &se : mat.L[k]) {
+                if(se.idx > i) continue;
+                y[k] -= se.val*y[se.idx];
+            }
+        }
+        y.resize(mat.m, 0.0);
+        dep.push_back(std::move(y));
+    }
+
+    std::vector<std::vector<double>> v;
     for(a = 0; a < 2; a++) {
         for(i = 0; i < SK.constraint.n; i++) {
             ConstraintBase *c = &(SK.constraint.elem[i]);
@@ -375,25 +649,227 @@ void System::FindWhichToRemoveToFixJacobian(Group *g, List<hConstraint> *bad) {
                 continue;
             }
 
-            param.ClearTags();
-            eq.Clear();
-            WriteEquationsExceptFor(c->h, g);
-            eq.ClearTags();
+            auto it = rowsOf.find(c->h.v);
+            size_t n = (it == rowsOf.end()) ? 0 : it->second.size();
+            if(n < dep.size()) continue;
+
+            v.assign(dep.size(), std::vector<double>(n));
+            for(j = 0; j < (int)dep.size(); j++) {
+                for(k = 0; k < (int)n; k++) {
+                    v[j][k] = dep[j][it->second[k]];
+                }
+            }
+            if(LinearlyIndependent(&v, RANK_MAG_TOLERANCE)) {
+                // We fix it by removing this constraint
+                bad->Add(&(c->h));
+            }
+        }
+    }
+}
 
-            // It's a major speedup to solve the easy ones by substitution here,
-            // and that doesn't break anything.
-            SolveBySubstitution();
+//-----------------------------------------------------------------------------
+// Split the equations that are still unassigned (tag 0) into independent
+// subsystems; two equations are in the same subsystem if they reference a
+// common unknown, directly or through other equations. Each subsystem gets
+// its own tag, starting from firstTag, on both its equations and the params
+// that it solves for. Params that appear in no equation stay at tag 0.
+// Returns one past the last tag used.
+//-----------------------------------------------------------------------------
+int System::TagConnectedComponents(int firstTag) {
+    int i;
 
-            WriteJacobian(0);
-            EvalJacobian();
+    // Union-find over the params; the root of each tree is the
+    // representative of its subsystem.
+    std::vector<int> parent(param.n);
+    for(i = 0; i < param.n; i++) {
+        parent[i] = i;
+    }
+    auto find = [&](int a) {
+        while(parent[a] != a) {
+            parent[a] = parent[parent[a]];
+            a = parent[a];
+        }
+        return a;
+    };
 
-            int rank = CalculateRank();
-            if(rank == mat.m) {
-                // We fixed it by removing this constraint
-                bad->Add(&(c->h));
+    // For each equation, the first unknown that it references, or -1.
+    std::vector<int> firstParam(eq.n, -1);
+    std::vector<hParam> used;
+    for(i = 0; i < eq.n; i++) {
+        Equation *e = &(eq.elem[i]);
+        if(e->tag != 0) continue;
+
+        used.clear();
+        e->e->ParamsUsedList(&used);
+        for(hParam hp : used) {
+            int pi = param.IndexOf(hp);
+            if(pi < 0 || param.elem[pi].tag != 0) continue;
+            if(firstParam[i] < 0) {
+                firstParam[i] = pi;
+            } else {
+                parent[find(pi)] = find(firstParam[i]);
             }
         }
     }
+
+    // And number the subsystems in the order that their equations appear.
+    std::vector<int> tagOf(param.n, 0);
+    int tag = firstTag;
+    for(i = 0; i < eq.n; i++) {
+        Equation *e = &(eq.elem[i]);
+        if(e->tag != 0) continue;
+
+        if(firstParam[i] < 0) {
+            // References no unknowns, so it's a subsystem by itself; and
+            // it will fail the rank test, as it should.
+            e->tag = tag++;
+            continue;
+        }
+        int root = find(firstParam[i]);
+        if(tagOf[root] == 0) tagOf[root] = tag++;
+        e->tag = tagOf[root];
+    }
+    for(i = 0; i < param.n; i++) {
+        Param *p = &(param.elem[i]);
+        if(p->tag != 0) continue;
+        p->tag = tagOf[find(i)];
+    }
+    return tag;
+}
+
+static uint64_t HashParam(uint64_t h, Param *p) {
+    h = HashMix(h, p->h.v);
+    h = HashMix(h, p->known);
+    if(p->known) h = HashDouble(h, p->val);
+    return h;
+}
+
+static uint64_t HashExpr(uint64_t h, Expr *e, ParamList *param) {
+    h = HashMix(h, (uint64_t)e->op);
+    switch(e->op) {
+        case Expr::PARAM: {
+            Param *p = param->FindByIdNoOops(e->parh);
+            if(!p) p = SK.param.FindByIdNoOops(e->parh);
+            h = p ? HashParam(h, p) : HashMix(h, e->parh.v);
+            break;
+        }
+        case Expr::PARAM_PTR:
+            h = HashParam(h, e->parp);
+            break;
+
+        case Expr::CONSTANT:
+            h = HashDouble(h, e->v);
+            break;
+
+        default: {
+            int c = e->Children();
+            if(c >= 1) h = HashExpr(h, e->a, param);
+            if(c >= 2) h = HashExpr(h, e->b, param);
+            break;
+        }
+    }
+    return h;
+}
+
+//-----------------------------------------------------------------------------
+// A fingerprint of everything that goes into the subsystems: the equations,
+// which params are unknown, the values of the known ones (since those get
+// written in as constants), and which params are dragged (since that chose
+// the weights). If this matches, then the subsystems from last time are
+// still good, and only the initial guesses have changed.
+//-----------------------------------------------------------------------------
+uint64_t System::HashSystem(void) {
+    uint64_t h = 0;
+    int i;
+
+    for(i = 0; i < param.n; i++) {
+        h = HashParam(h, &(param.elem[i]));
+    }
+    for(i = 0; i < eq.n; i++) {
+        Equation *e = &(eq.elem[i]);
+        h = HashMix(h, e->h.v);
+        h = HashExpr(h, e->e, &param);
+    }
+    hParam *hp;
+    for(hp = dragged.First(); hp; hp = dragged.NextAfter(hp)) {
+        h = HashMix(h, hp->v);
+    }
+    return h;
+}
+
+//-----------------------------------------------------------------------------
+// If we've got the subsystems for exactly this group's system from last time,
+// then solve those again, starting from the new initial guesses. Returns
+// false if that's not possible or didn't converge, in which case the params
+// are left as they were, and it's up to the caller to solve from scratch.
+//-----------------------------------------------------------------------------
+bool System::SolveAgain(hGroup hg, uint64_t hash, int *dof) {
+    int i, t;
+
+    auto it = reuse.find(hg.v);
+    if(it == reuse.end()) return false;
+    Reuse *r = &(it->second);
+    if(r->hash != hash) return false;
+    if((int)r->param.size() != param.n) return false;
+
+    // The param table was written again, so restore how the params were
+    // assigned to the subsystems, and point the subsystems at the new table.
+    std::vector<double> start(param.n);
+    for(i = 0; i < param.n; i++) {
+        Param *p = &(param.elem[i]), *pp = &(r->param[i]);
+        start[i] = p->val;
+        p->tag = pp->tag;
+        p->substd = pp->substd;
+        p->free = false;
+    }
+    for(Matrix &mtx : r->block) {
+        mtx.Rebind(&param, &(SK.param));
+    }
+
+    // The single equations are independent of each other, but the others
+    // may refer to the params that they solve for, so they must go first.
+    // The rank can change as things move, so that's tested again, just as
+    // Solve() would after solving.
+    std::vector<char> ok(r->block.size(), 0);
+    ParallelFor(r->alone, workerThreads, [&](int b) {
+        ok[b] = r->block[b].SolveNearby();
+    });
+    ParallelFor((int)r->block.size() - r->alone, workerThreads, [&](int b) {
+        Matrix *mtx = &(r->block[r->alone + b]);
+        ok[r->alone + b] = mtx->SolveNearby() && mtx->TestRank();
+        if(ok[r->alone + b]) mtx->FactorForStep();
+    });
+    for(t = 0; t < (int)r->block.size(); t++) {
+        if(ok[t]) continue;
+
+        for(i = 0; i < param.n; i++) {
+            param.elem[i].val = start[i];
+        }
+        return false;
+    }
+
+    if(dof) *dof = r->dof;
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// The system solved correctly, so write the new values back in to the main
+// parameter table.
+//-----------------------------------------------------------------------------
+void System::WriteParamsBack(void) {
+    for(int i = 0; i < param.n; i++) {
+        Param *p = &(param.elem[i]);
+        double val;
+        if(p->tag == VAR_SUBSTITUTED) {
+            val = param.FindById(p->substd)->val;
+        } else {
+            val = p->val;
+        }
+        Param *pp = SK.GetParam(p->h);
+        pp->val = val;
+        pp->known = true;
+        pp->free = p->free;
+    }
 }
 
 int System::Solve(Group *g, int *dof, List<hConstraint> *bad,
@@ -401,8 +877,19 @@ int System::Solve(Group *g, int *dof, List<hConstraint> *bad,
 {
     WriteEquationsExceptFor(Constraint::NO_CONSTRAINT, g);
 
-    int i;
-    bool rankOk;
+    int i, t, blocks, dofLeft;
+    bool rankOk = true, solvedRankOk = true;
+    std::vector<char> preRankOk, converged, postRankOk;
+
+    // If nothing changed but the initial guesses since last time, then
+    // there's no need to write and rank test the subsystems again.
+    uint64_t hash = HashSystem();
+    if(!andFindFree && SolveAgain(g->h, hash, dof)) {
+        WriteParamsBack();
+        return System::SOLVED_OKAY;
+    }
+    reuse.erase(g->h.v);
+    block.clear();
 
 /*
     dbp("%d equations", eq.n);
@@ -438,28 +925,66 @@ int System::Solve(Group *g, int *dof, List<hConstraint> *bad,
 
         e->tag = alone;
         p->tag = alone;
-        WriteJacobian(alone);
-        if(!NewtonSolve(alone)) {
+        block.emplace_back();
+        WriteJacobian(alone, &block.back());
+        if(!block.back().NewtonSolve()) {
             // Failed to converge, bail out early
+            mat = std::move(block.back());
             goto didnt_converge;
         }
         alone++;
     }
 
-    // Now write the Jacobian for what's left, and do a rank test; that
-    // tells us if the system is inconsistently constrained.
-    if(!WriteJacobian(0)) {
-        return System::TOO_MANY_UNKNOWNS;
+    // Whatever's left usually falls apart into independent subsystems (like
+    // separate profiles in the same sketch); the Jacobian is block diagonal
+    // with a block for each, so solve and rank test them one at a time.
+    // First, count the unknowns that are left. Any substitutions or
+    // single-eq solves removed one equation and one unknown, therefore no
+    // effect on the number of DOF.
+    dofLeft = 0;
+    for(i = 0; i < param.n; i++) {
+        if(param.elem[i].tag == 0) dofLeft++;
     }
-
-    rankOk = TestRank();
-
-    // And do the leftovers as one big system
-    if(!NewtonSolve(0)) {
-        goto didnt_converge;
+    for(i = 0; i < eq.n; i++) {
+        if(eq.elem[i].tag == 0) dofLeft--;
+    }
+    blocks = TagConnectedComponents(alone);
+
+    // Writing the Jacobian allocates expressions, so that's done here; but
+    // the subsystems share no unknowns, so the numerical work on each can go
+    // in parallel.
+    // Tag t goes in block[t - 1], after the single equations.
+    block.resize(blocks - 1);
+    for(t = alone; t < blocks; t++) {
+        WriteJacobian(t, &block[t - 1]);
+    }
+    preRankOk.assign(blocks - alone, 0);
+    converged.assign(blocks - alone, 0);
+    postRankOk.assign(blocks - alone, 0);
+    ParallelFor(blocks - alone, workerThreads, [&](int b) {
+        Matrix *mtx = &block[alone - 1 + b];
+        // The rank test before we solve tells us if the system is
+        // inconsistently constrained; we need that for every subsystem, even
+        // if one fails to converge.
+        preRankOk[b] = mtx->TestRank();
+        converged[b] = mtx->NewtonSolve();
+        if(converged[b]) postRankOk[b] = mtx->TestRank();
+        // and leave it factored at the solution, for next time.
+        if(postRankOk[b]) mtx->FactorForStep();
+    });
+    for(t = 0; t < blocks - alone; t++) {
+        if(!preRankOk[t]) rankOk = false;
+        if(!postRankOk[t]) solvedRankOk = false;
+    }
+    for(t = 0; t < blocks - alone; t++) {
+        if(!converged[t]) {
+            // Report what was unsatisfied in the first one that failed.
+            mat = std::move(block[alone - 1 + t]);
+            goto didnt_converge;
+        }
     }
 
-    rankOk = TestRank();
+    rankOk = solvedRankOk;
     if(!rankOk) {
         if(!g->allowRedundant) {
             if(andFindBad) FindWhichToRemoveToFixJacobian(g, bad);
@@ -467,52 +992,45 @@ int System::Solve(Group *g, int *dof, List<hConstraint> *bad,
         }
     }
 
-    // This is not the full Jacobian, but any substitutions or single-eq
-    // solves removed one equation and one unknown, therefore no effect
-    // on the number of DOF.
-    if(dof) *dof = mat.n - mat.m;
+    if(dof) *dof = dofLeft;
 
     // If requested, find all the free (unbound) variables. This might be
     // more than the number of degrees of freedom. Don't always do this,
-    // because the display would get annoying and it's slow.
+    // because the display would get annoying. A variable that appears in no
+    // equation is free, unless the system is redundant; one that was solved
+    // alone is not; and any other is free if its subsystem keeps full rank
+    // without it.
     for(i = 0; i < param.n; i++) {
         Param *p = &(param.elem[i]);
-        p->free = false;
-
-        if(andFindFree) {
-            if(p->tag == 0) {
-                p->tag = VAR_DOF_TEST;
-                WriteJacobian(0);
-                EvalJacobian();
-                int rank = CalculateRank();
-                if(rank == mat.m) {
-                    p->free = true;
-                }
-                p->tag = 0;
-            }
-        }
+        p->free = (andFindFree && rankOk && p->tag == 0);
+    }
+    if(andFindFree && rankOk) {
+        ParallelFor(blocks - alone, workerThreads, [&](int b) {
+            Matrix *mtx = &block[alone - 1 + b];
+            mtx->MarkFreeParams();
+            // and leave it factored for next time, as above.
+            mtx->FactorForStep();
+        });
     }
 
-    // System solved correctly, so write the new values back in to the
-    // main parameter table.
-    for(i = 0; i < param.n; i++) {
-        Param *p = &(param.elem[i]);
-        double val;
-        if(p->tag == VAR_SUBSTITUTED) {
-            val = param.FindById(p->substd)->val;
-        } else {
-            val = p->val;
-        }
-        Param *pp = SK.GetParam(p->h);
-        pp->val = val;
-        pp->known = true;
-        pp->free = p->free;
+    WriteParamsBack();
+    if(!rankOk) return System::REDUNDANT_OKAY;
+
+    // Keep the subsystems, in case we're asked to solve this again.
+    {
+        Reuse *r = &reuse[g->h.v];
+        r->hash = hash;
+        r->alone = alone - 1;
+        r->dof = dofLeft;
+        r->block = std::move(block);
+        r->param.assign(param.elem, param.elem + param.n);
+        block.clear();
     }
-    return rankOk ? System::SOLVED_OKAY : System::REDUNDANT_OKAY;
+    return System::SOLVED_OKAY;
 
 didnt_converge:
     SK.constraint.ClearTags();
-    for(i = 0; i < eq.n; i++) {
+    for(i = 0; i < mat.m; i++) {
         if(ffabs(mat.B.num[i]) > CONVERGE_TOLERANCE || isnan(mat.B.num[i])) {
             // This constraint is unsatisfied.
             if(!mat.eq[i].isFromConstraint()) continue;
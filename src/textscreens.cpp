@@ -499,10 +499,6 @@ void TextWindow::ShowGroupSolveInfo(void) {
             Printf(true, "%FxSOLVE FAILED!%Fd redundant constraints");
             Printf(true, "remove any one of these to fix it");
             break;
-
-        case System::TOO_MANY_UNKNOWNS:
-            Printf(true, "Too many unknowns in a single group!");
-            return;
     }
 
     for(int i = 0; i < g->solved.remove.n; i++) {
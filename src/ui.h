@@ -157,6 +157,7 @@ public:
         EDIT_G_CODE_FEED           = 122,
         EDIT_G_CODE_PLUNGE_FEED    = 123,
         EDIT_AUTOSAVE_INTERVAL     = 124,
+        EDIT_WORKER_THREADS        = 125,
         // For TTF text
         EDIT_TTF_TEXT              = 300,
         // For the step dimension screen
@@ -275,6 +276,7 @@ public:
     static void ScreenChangeFixExportColors(int link, uint32_t v);
     static void ScreenChangeBackFaces(int link, uint32_t v);
     static void ScreenChangeCheckClosedContour(int link, uint32_t v);
+    static void ScreenChangeMonotoneTriangulation(int link, uint32_t v);
     static void ScreenChangePwlCurves(int link, uint32_t v);
     static void ScreenChangeCanvasSizeAuto(int link, uint32_t v);
     static void ScreenChangeCanvasSize(int link, uint32_t v);
@@ -310,6 +312,7 @@ public:
     static void ScreenChangeExportOffset(int link, uint32_t v);
     static void ScreenChangeGCodeParameter(int link, uint32_t v);
     static void ScreenChangeAutosaveInterval(int link, uint32_t v);
+    static void ScreenChangeWorkerThreads(int link, uint32_t v);
     static void ScreenChangeStyleName(int link, uint32_t v);
     static void ScreenChangeStyleMetric(int link, uint32_t v);
     static void ScreenChangeStyleTextAngle(int link, uint32_t v);
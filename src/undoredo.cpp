@@ -62,6 +62,8 @@ void SolveSpaceUI::PushFromCurrentOnto(UndoStack *uk) {
         dest.runningMesh = {};
         dest.thisShell = {};
         dest.runningShell = {};
+        dest.thisHash = 0;
+        dest.runningHash = 0;
         dest.displayMesh = {};
         dest.displayEdges = {};
         dest.displayOutlines = {};
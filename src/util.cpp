@@ -5,6 +5,10 @@
 // Copyright 2008-2013 Jonathan Westhues.
 //-----------------------------------------------------------------------------
 #include "solvespace.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 std::string SolveSpace::ssprintf(const char *fmt, ...)
 {
@@ -171,6 +175,285 @@ bool SolveSpace::CnfThawBool(bool v, const std::string &name)
 RgbaColor SolveSpace::CnfThawColor(RgbaColor v, const std::string &name)
     { return RgbaColor::FromPackedInt(CnfThawInt(v.ToPackedInt(), name)); }
 
+//-----------------------------------------------------------------------------
+// Running hashes, to fingerprint the inputs to some expensive computation so
+// that we can tell when its result from last time is still good. Doubles get
+// hashed by their bits, so any change at all counts.
+//-----------------------------------------------------------------------------
+uint64_t SolveSpace::HashMix(uint64_t h, uint64_t v) {
+    h ^= v;
+    h *= 0x9e3779b97f4a7c15ULL;
+    return h ^ (h >> 32);
+}
+
+uint64_t SolveSpace::HashDouble(uint64_t h, double v) {
+    uint64_t bits;
+    memcpy(&bits, &v, sizeof(double));
+    return HashMix(h, bits);
+}
+
+//-----------------------------------------------------------------------------
+// A pool of worker threads, for work that splits into independent pieces.
+// The threads are started the first time that they're needed, and then sleep
+// until there's more; the calling thread always takes a share of the work
+// too. The pool is never torn down, so its threads are detached.
+//-----------------------------------------------------------------------------
+namespace {
+struct WorkerPool {
+    std::mutex                  busy;           // held by the caller of a job
+    std::mutex                  mutex;          // protects everything below
+    std::condition_variable     wake, done;
+    int                         threads = 0;
+    uint64_t                    generation = 0;
+    int                         wanted = 0;     // workers yet to join this job
+    int                         running = 0;    // workers not yet done with it
+
+    const std::function<void(int)> *fn = NULL;
+    int                         n = 0;
+    std::atomic<int>            next{0};
+
+    void RunItems(void) {
+        for(;;) {
+            int i = next++;
+            if(i >= n) break;
+            (*fn)(i);
+        }
+    }
+};
+}
+
+static thread_local bool InWorker;
+
+static void WorkerMain(WorkerPool *pool) {
+    InWorker = true;
+
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(pool->mutex);
+    for(;;) {
+        pool->wake.wait(lock, [&] {
+            return pool->generation != seen && pool->wanted > 0;
+        });
+        seen = pool->generation;
+        pool->wanted--;
+
+        lock.unlock();
+        pool->RunItems();
+        lock.lock();
+
+        if(--pool->running == 0) pool->done.notify_all();
+    }
+}
+
+int SolveSpace::CpuCount(void) {
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+//-----------------------------------------------------------------------------
+// Call fn(i) for each i in [0, n), using up to the given number of threads
+// (counting the caller). The calls happen in no particular order, so they
+// must be independent of each other. If the pool is busy with another job,
+// or we're already on a worker thread, then everything runs on the calling
+// thread instead; so it's safe to nest these.
+//-----------------------------------------------------------------------------
+void SolveSpace::ParallelFor(int n, int threads,
+                             const std::function<void(int)> &fn)
+{
+    static WorkerPool *Pool = new WorkerPool();
+
+    threads = std::min(threads, n);
+    if(threads <= 1 || InWorker || !Pool->busy.try_lock()) {
+        for(int i = 0; i < n; i++) fn(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(Pool->mutex);
+        while(Pool->threads < threads - 1) {
+            std::thread(WorkerMain, Pool).detach();
+            Pool->threads++;
+        }
+        Pool->fn = &fn;
+        Pool->n = n;
+        Pool->next = 0;
+        Pool->wanted = threads - 1;
+        Pool->running = threads - 1;
+        Pool->generation++;
+    }
+    Pool->wake.notify_all();
+
+    Pool->RunItems();
+
+    {
+        std::unique_lock<std::mutex> lock(Pool->mutex);
+        // Any workers that haven't woken up yet would find nothing to do.
+        Pool->running -= Pool->wanted;
+        Pool->wanted = 0;
+        Pool->done.wait(lock, [&] { return Pool->running == 0; });
+    }
+    Pool->busy.unlock();
+}
+
+//-----------------------------------------------------------------------------
+// A separate heap, on which we allocate expressions and other temporary
+// stuff. Allocations are carved out of big chunks, so that's fast; and it
+// also makes it possible to be sloppy with our memory management, and just
+// free everything at once at the end. Each thread gets its own arena, so
+// worker threads can allocate too, without any locking; but that means that
+// FreeAllTemporary() must be called only while the workers are idle.
+//-----------------------------------------------------------------------------
+namespace {
+struct TempChunk {
+    TempChunk  *next;
+    size_t      size;       // of the data, which follows this header
+    size_t      used;
+};
+
+struct TempArena {
+    TempChunk  *chunks;     // the one that we're allocating from first
+    TempChunk  *big;        // each allocation too big to share a chunk
+    TempChunk  *spare;      // kept from last time, for the next chunk
+    uint64_t    allocs;
+    uint64_t    bytes;
+    size_t      reserved;
+    size_t      peak;
+};
+}
+
+static const size_t TEMP_ALIGN  = 16;
+static const size_t TEMP_HEADER =
+    (sizeof(TempChunk) + TEMP_ALIGN - 1) & ~(TEMP_ALIGN - 1);
+static const size_t TEMP_CHUNK  = 1024*1024;
+static const size_t TEMP_BIG    = TEMP_CHUNK/4;
+
+static std::mutex                   TempArenasMutex;
+static std::vector<TempArena *>     TempArenas;
+static thread_local TempArena      *ThisTempArena;
+
+static TempArena *GetTempArena(void) {
+    if(!ThisTempArena) {
+        ThisTempArena = new TempArena();
+        std::lock_guard<std::mutex> lock(TempArenasMutex);
+        TempArenas.push_back(ThisTempArena);
+    }
+    return ThisTempArena;
+}
+
+static uint8_t *TempData(TempChunk *c) {
+    return (uint8_t *)c + TEMP_HEADER;
+}
+
+static TempChunk *NewTempChunk(TempArena *a, size_t size) {
+    TempChunk *c = (TempChunk *)malloc(TEMP_HEADER + size);
+    if(!c) oops();
+    c->next = NULL;
+    c->size = size;
+    c->used = 0;
+    a->reserved += size;
+    a->peak = std::max(a->peak, a->reserved);
+    return c;
+}
+
+static void FreeTempChunks(TempArena *a, TempChunk *c) {
+    while(c) {
+        TempChunk *f = c;
+        c = c->next;
+        a->reserved -= f->size;
+        free(f);
+    }
+}
+
+void *SolveSpace::AllocTemporary(size_t n)
+{
+    TempArena *a = GetTempArena();
+    n = std::max(TEMP_ALIGN, (n + TEMP_ALIGN - 1) & ~(TEMP_ALIGN - 1));
+    a->allocs++;
+    a->bytes += n;
+
+    uint8_t *p;
+    if(n > TEMP_BIG) {
+        TempChunk *c = NewTempChunk(a, n);
+        c->used = n;
+        c->next = a->big;
+        a->big = c;
+        p = TempData(c);
+    } else {
+        TempChunk *c = a->chunks;
+        if(!c || c->used + n > c->size) {
+            if(a->spare) {
+                c = a->spare;
+                a->spare = NULL;
+            } else {
+                c = NewTempChunk(a, TEMP_CHUNK);
+            }
+            c->next = a->chunks;
+            a->chunks = c;
+        }
+        p = TempData(c) + c->used;
+        c->used += n;
+    }
+    memset(p, 0, n);
+    return p;
+}
+
+//-----------------------------------------------------------------------------
+// Free something from the temporary heap early; that's worth doing only for
+// big allocations, which have their own chunk. Anything else just stays
+// until FreeAllTemporary(). Must be called on the thread that allocated it.
+//-----------------------------------------------------------------------------
+void SolveSpace::FreeTemporary(void *p)
+{
+    TempArena *a = GetTempArena();
+    for(TempChunk **pc = &(a->big); *pc; pc = &((*pc)->next)) {
+        TempChunk *c = *pc;
+        if(TempData(c) != p) continue;
+
+        *pc = c->next;
+        a->reserved -= c->size;
+        free(c);
+        return;
+    }
+}
+
+void SolveSpace::FreeAllTemporary(void)
+{
+    std::lock_guard<std::mutex> lock(TempArenasMutex);
+    for(TempArena *a : TempArenas) {
+        FreeTempChunks(a, a->big);
+        a->big = NULL;
+        // Keep one chunk, since we'll probably need it again soon.
+        if(!a->spare && a->chunks) {
+            a->spare = a->chunks;
+            a->chunks = a->chunks->next;
+            a->spare->next = NULL;
+            a->spare->used = 0;
+        }
+        FreeTempChunks(a, a->chunks);
+        a->chunks = NULL;
+    }
+#ifdef WIN32
+    // This is a good place to validate, because it gets called fairly
+    // often.
+    vl();
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// The temporary heap's counters, summed over all the threads; the counts of
+// allocations and bytes only ever increase, so that the difference between
+// two calls is how much was allocated in between.
+//-----------------------------------------------------------------------------
+void SolveSpace::GetTemporaryStats(TemporaryStats *ts)
+{
+    *ts = {};
+    std::lock_guard<std::mutex> lock(TempArenasMutex);
+    for(TempArena *a : TempArenas) {
+        ts->allocs   += a->allocs;
+        ts->bytes    += a->bytes;
+        ts->reserved += a->reserved;
+        ts->peak     += a->peak;
+    }
+}
+
 //-----------------------------------------------------------------------------
 // Solve a mostly banded matrix. In a given row, there are LEFT_OF_DIAG
 // elements to the left of the diagonal element, and RIGHT_OF_DIAG elements to